@@ -23,6 +23,56 @@ void printSummary(int hits, int misses, int evictions)
     fclose(output_fp);
 }
 
+/* 
+ * printLevelSummary - Summarize the statistics of one level of a cache
+ *                     hierarchy, in the format of printSummary
+ */
+void printLevelSummary(const char* level, unsigned long long hits,
+                       unsigned long long misses, unsigned long long evictions,
+                       unsigned long long invalidations,
+                       unsigned long long dirty_evictions,
+                       unsigned long long bytes_written)
+{
+    printf("%s hits:%llu misses:%llu evictions:%llu invalidations:%llu"
+           " dirty_evictions:%llu bytes_written:%llu\n",
+           level, hits, misses, evictions, invalidations,
+           dirty_evictions, bytes_written);
+}
+
+/*
+ * printWriteSummary - Summarize the dirty evictions and write traffic
+ *                     of a single cache, after printSummary
+ */
+void printWriteSummary(unsigned long long dirty_evictions,
+                       unsigned long long bytes_written)
+{
+    printf("dirty_evictions:%llu bytes_written:%llu\n",
+           dirty_evictions, bytes_written);
+}
+
+/*
+ * printSplitSummary - Summarize the line-crossing accesses, after
+ *                     printSummary
+ */
+void printSplitSummary(unsigned long long splits)
+{
+    printf("line_splits:%llu\n", splits);
+}
+
+/*
+ * printPrefetchSummary - Summarize the prefetches of a single cache,
+ *                        after printSummary
+ */
+void printPrefetchSummary(unsigned long long prefetches,
+                          unsigned long long useful,
+                          unsigned long long late,
+                          unsigned long long polluting,
+                          unsigned long long evictions)
+{
+    printf("prefetches:%llu useful:%llu late:%llu polluting:%llu pf_evictions:%llu\n",
+           prefetches, useful, late, polluting, evictions);
+}
+
 /* 
  * initMatrix - Initialize the given matrix 
  */
@@ -24,6 +24,41 @@ void printSummary(int hits,  /* number of  hits */
 				  int misses, /* number of misses */
 				  int evictions); /* number of evictions */
 
+/*
+ * printLevelSummary - The same statistics for one level of a cache
+ * hierarchy, plus the blocks it lost to back-invalidation, the dirty
+ * blocks it evicted and the bytes it wrote to the next level
+ */
+void printLevelSummary(const char* level,
+                       unsigned long long hits,
+                       unsigned long long misses,
+                       unsigned long long evictions,
+                       unsigned long long invalidations,
+                       unsigned long long dirty_evictions,
+                       unsigned long long bytes_written);
+
+/*
+ * printWriteSummary - The write-back statistics of a single cache
+ */
+void printWriteSummary(unsigned long long dirty_evictions, /* dirty blocks evicted */
+                       unsigned long long bytes_written);  /* bytes written to memory */
+
+/*
+ * printSplitSummary - The number of accesses that crossed a block
+ * boundary and were split into one access per block
+ */
+void printSplitSummary(unsigned long long splits);
+
+/*
+ * printPrefetchSummary - The prefetches issued, how many of them
+ * were useful, late or polluting, and the blocks their fills evicted
+ */
+void printPrefetchSummary(unsigned long long prefetches,
+                          unsigned long long useful,
+                          unsigned long long late,
+                          unsigned long long polluting,
+                          unsigned long long evictions);
+
 /* Fill the matrix with data */
 void initMatrix(int M, int N, int A[N][M], int B[M][N]);
 
@@ -1,283 +1,2268 @@
-#include <getopt.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <stdio.h>
-#include <assert.h>
-#include <math.h>
-#include <limits.h>
-#include <string.h>
-#include <errno.h>
-#include "cachelab.h"
-
-//#define DEBUG_ON 
-//内存地址长度
-#define ADDRESS_LENGTH 64
-
-/* Type: Memory address */
-//定义内存地址
-typedef unsigned long long int mem_addr_t;
-
-/* Type: Cache line
-   LRU is a counter used to implement LRU replacement policy  */
-//定义了一个缓存行
-typedef struct cache_line {
-    char valid; //有效位
-    mem_addr_t tag; //标记位
-    unsigned long long int lru; //缓存块，存有信息（时间）
-} cache_line_t;
-
-typedef cache_line_t* cache_set_t;  //定义一个组指针指向组的第一个行
-typedef cache_set_t* cache_t;   //定义一个缓存指针指向第一个组
-
-/* Globals set by command line args */
-//命令行设置的参数
-int verbosity = 0; /* print trace if set */ //显示轨迹信息
-int s = 0; /* set index bits */     //设置内存中组索引的位数
-int b = 0; /* block offset bits */  //内存块中地址的位数（块偏移位数）
-int E = 0; /* associativity */  //每组中的缓存行数
-char* trace_file = NULL;    //trace_file的char指针
-
-/* Derived from command line args */
-int S; /* number of sets 缓存中的组个数*/
-int B; /* block size (bytes) 高速缓存块的字节数*/
-
-/* Counters used to record cache statistics */
-//用于记录cache的性能统计
-int miss_count = 0;     //不命中次数
-int hit_count = 0;      //命中次数
-int eviction_count = 0; //驱逐次数
-unsigned long long int lru_counter = 1; //一个记录最后一次访问时间的值，越小越早访问
-
-/* The cache we are simulating */
-//主缓存
-cache_t cache;  
-mem_addr_t set_index_mask;
-
-/* 
- * initCache - Allocate memory, write 0's for valid and tag and LRU
- * also computes the set_index_mask
- * 初始化缓存，将缓存中的所有数据位置0，同时计算set_index_mask
- */
-void initCache()
-{
-    cache = malloc(S * sizeof(cache_set_t));    //先分配cache的内存
-    int i = 0;
-    int j = 0;
-    for(i = 0; i < S; i ++)
-    {
-        cache[i] = malloc(E * sizeof(cache_line_t));    //分配每个组的内存
-        for(j = 0; j < E; j ++)
-        {
-            cache[i][j].valid = 'n';
-            cache[i][j].tag = 0;
-            cache[i][j].lru = 0;
-        }
-    }
-}
-
-
-/* 
- * freeCache - free allocated memory
- * 释放分配的内存
- */
-void freeCache()
-{
-    int i = 0;
-    for(i = 0; i < S; i ++)
-    {
-        free(cache[i]); //逐个组释放
-    }
-    free(cache);    //释放整个cache
-}
-
-
-/* 
- * accessData - Access data at memory address addr. 按照内存访问数据
- *   If it is already in cache, increast hit_count  如果已经在cache中了，hit_cache++
- *   If it is not in cache, bring it in cache, increase miss count. 如果不在cache中，把它放入cache中，miss_count++
- *   Also increase eviction_count if a line is evicted. 同时如果一个行被驱逐时，eviction_count++
- */
-void accessData(mem_addr_t addr)
-{
-    unsigned long long int temp = addr; //用于位操作的临时保存
-    unsigned long long int tempIndex;   //组索引
-    tempIndex = temp << (ADDRESS_LENGTH - b - s);    //剩余组索引和块偏移
-    tempIndex = tempIndex >> (ADDRESS_LENGTH - s);   //得到组索引
-    unsigned long long int tempTag;    //标记
-    tempTag = temp >> (s + b);
-    int i = 0;
-    int flag = 0;   //指示最终是否命中
-    int hasInvalid = 0; //标记该组是否存在非有效位（空位）
-    for(i = 0; i < E; i ++) //组已经确定，遍历该组的行
-    {
-        //有效且标记位相等
-        if(cache[tempIndex][i].valid == 'y' && tempTag == cache[tempIndex][i].tag)
-        {
-            lru_counter++;  //时间++
-            hit_count++;    //命中次数++
-            cache[tempIndex][i].lru = lru_counter;  //重置块最后访问时间
-            flag = 1;   //标记此次访问命中
-            break;
-        }
-        if(cache[tempIndex][i].valid != 'y')
-        {
-            hasInvalid = 1;
-        }
-    }
-
-    if(flag == 0)   //不命中的情况
-    {
-        miss_count++;   //不命中次数++
-        if(hasInvalid == 1) //存在空位，直接替换空位
-        {
-            for(i = 0; i < E; i ++)
-            {
-                if(cache[tempIndex][i].valid != 'y')    //发现空块
-                {
-                    lru_counter++;  //时间++
-                    cache[tempIndex][i].valid = 'y';    //该块有效
-                    cache[tempIndex][i].lru = lru_counter;  //写入块最后访问时间
-                    cache[tempIndex][i].tag = tempTag;  //写入块标记
-                    break;
-                }
-            }
-        }
-        else    //无空块，执行LRU替换策略，驱逐最早被使用的块
-        {
-            eviction_count++;   //驱逐次数++
-            unsigned long long int tempTime;    //临时的最早的时间
-            tempTime = cache[tempIndex][0].lru;
-            unsigned long long int replaceIndex = 0;    //被替换的块的索引
-            for(i = 0; i < E; i ++) //寻找最早被使用的块
-            {
-                if(cache[tempIndex][i].lru < tempTime)
-                {
-                    tempTime = cache[tempIndex][i].lru;
-                    replaceIndex = i;
-                }
-            }
-            lru_counter++;  //时间++
-            cache[tempIndex][replaceIndex].valid = 'y';
-            cache[tempIndex][replaceIndex].lru = lru_counter;
-            cache[tempIndex][replaceIndex].tag = tempTag;
-        }
-    }
-}
-
-
-/*
- * replayTrace - replays the given trace file against the cache 
- */
-void replayTrace(char* trace_fn)
-{
-    char buf[1000];
-    mem_addr_t addr=0;
-    unsigned int len=0;
-    FILE* trace_fp = fopen(trace_fn, "r");
-
-    if(!trace_fp){
-        fprintf(stderr, "%s: %s\n", trace_fn, strerror(errno));
-        exit(1);
-    }
-
-    while( fgets(buf, 1000, trace_fp) != NULL) {
-        if(buf[1]=='S' || buf[1]=='L' || buf[1]=='M') {
-            sscanf(buf+3, "%llx,%u", &addr, &len);
-      
-            if(verbosity)
-                printf("%c %llx,%u ", buf[1], addr, len);
-
-            accessData(addr);
-
-            /* If the instruction is R/W then access again */
-            if(buf[1]=='M')
-                accessData(addr);
-            
-            if (verbosity)
-                printf("\n");
-        }
-    }
-
-    fclose(trace_fp);
-}
-
-/*
- * printUsage - Print usage info
- */
-void printUsage(char* argv[])
-{
-    printf("Usage: %s [-hv] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
-    printf("Options:\n");
-    printf("  -h         Print this help message.\n");
-    printf("  -v         Optional verbose flag.\n");
-    printf("  -s <num>   Number of set index bits.\n");
-    printf("  -E <num>   Number of lines per set.\n");
-    printf("  -b <num>   Number of block offset bits.\n");
-    printf("  -t <file>  Trace file.\n");
-    printf("\nExamples:\n");
-    printf("  linux>  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
-    printf("  linux>  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv[0]);
-    exit(0);
-}
-
-/*
- * main - Main routine 
- */
-int main(int argc, char* argv[])
-{
-    char c;
-
-    while( (c=getopt(argc,argv,"s:E:b:t:vh")) != -1){
-        switch(c){
-        case 's':
-            s = atoi(optarg);
-            break;
-        case 'E':
-            E = atoi(optarg);
-            break;
-        case 'b':
-            b = atoi(optarg);
-            break;
-        case 't':
-            trace_file = optarg;
-            break;
-        case 'v':
-            verbosity = 1;
-            break;
-        case 'h':
-            printUsage(argv);
-            exit(0);
-        default:
-            printUsage(argv);
-            exit(1);
-        }
-    }
-
-    /* Make sure that all required command line args were specified */
-    if (s == 0 || E == 0 || b == 0 || trace_file == NULL) {
-        printf("%s: Missing required command line argument\n", argv[0]);
-        printUsage(argv);
-        exit(1);
-    }
-
-    /* Compute S, E and B from command line args */
-    S = pow(2, s);
-    B = pow(2, b);
- 
-    /* Initialize cache */
-    initCache();
-
-#ifdef DEBUG_ON
-    printf("DEBUG: S:%u E:%u B:%u trace:%s\n", S, E, B, trace_file);
-    printf("DEBUG: set_index_mask: %llu\n", set_index_mask);
-#endif
- 
-    replayTrace(trace_file);
-
-    /* Free allocated memory */
-    freeCache();
-
-    /* Output the hit and miss statistics for the autograder */
-    printSummary(hit_count, miss_count, eviction_count);
-    return 0;
-}
+#define _POSIX_C_SOURCE 200809L
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "cachelab.h"
+#include "trace.h"
+
+//#define DEBUG_ON 
+//内存地址长度
+#define ADDRESS_LENGTH 64
+
+/* Type: Memory address */
+//定义内存地址
+typedef unsigned long long int mem_addr_t;
+
+/* Type: Cache set
+   The whole cache is one contiguous block of 64-bit words. Each set is a
+   record [valid bitmask][dirty bitmask][prefetched bitmask, only with a
+   prefetcher][policy bits][E tags][per-way policy state], so
+   one access only touches the record of its own set, usually one or two
+   host cache lines. Which state a set carries depends on the replacement
+   policy (see policy_t); for LRU and FIFO it is one stamp per way from a
+   counter that advances on every access. An empty way always has stamp
+   0, below every stamp in use, so the way with the smallest stamp of a
+   set is also its first empty way  */
+//整个cache是一块连续内存，每个组按 有效位图|脏位图|策略位|E个标记|每行的策略状态 连续存放
+//空行的时间戳恒为0，因此时间戳最小的行就是第一个空行
+typedef unsigned long long int cache_word_t;
+
+/* Type: Replacement policy, with the per-set state each one keeps
+     LRU     a 64-bit last-access stamp per way
+     FIFO    a 64-bit fill stamp per way
+     RANDOM  no state, a per-cache xorshift generator picks the victim
+     PLRU    tree pseudo-LRU, E-1 direction bits per set (E a power of 2)
+     BITPLRU one MRU bit per way, cleared for the others when all are set
+     SRRIP   a 2-bit re-reference prediction value per way, filled at 2
+     BRRIP   as SRRIP, but filled at 3 except for one fill in 32
+     LFU     a saturating 32-bit use count per way, lowest index on ties */
+//替换策略及每组保存的状态
+typedef enum {
+    POLICY_LRU, POLICY_FIFO, POLICY_RANDOM, POLICY_PLRU,
+    POLICY_BITPLRU, POLICY_SRRIP, POLICY_BRRIP, POLICY_LFU
+} policy_t;
+
+const char* policy_names[] = {
+    "lru", "fifo", "random", "plru", "bitplru", "srrip", "brrip", "lfu"
+};
+
+#define RRPV_MAX 3      //2位重引用预测值的最大值，表示很久以后才会再用到
+#define RRIP_FIELDS 0x5555555555555555ULL   //每个2位字段的最低位
+#define BRRIP_LONG 32   //BRRIP每32次填充中有一次按SRRIP插入
+
+/* Write policy flags of a cache
+     WRITE_THROUGH     a store is passed on to the next level at once and
+                       no line is ever dirty; otherwise stores mark the
+                       line dirty and it is written back when evicted
+     WRITE_NO_ALLOCATE a store miss is passed on without filling a line;
+                       otherwise the block is filled first, like a load */
+//写策略：默认为写回+写分配
+#define WRITE_THROUGH       1
+#define WRITE_NO_ALLOCATE   2
+
+/* Type: Hardware prefetcher
+     NONE    no prefetching
+     NEXT    a miss, or the first hit on a prefetched block, prefetches
+             the next pf_degree blocks
+     STRIDE  a table indexed by 4 KB region learns the distance between
+             successive accesses within each region, and prefetches
+             pf_degree strides ahead once a stride repeats
+     STREAM  follows up to PF_STREAMS ascending or descending runs of
+             misses within a region and keeps pf_degree blocks ahead of
+             each one whose direction is known
+   Prefetches fill the cache like misses but are not counted as accesses,
+   and the blocks they evict are counted apart from demand evictions, so
+   hits, misses and evictions stay comparable to a run without -p.
+   Prefetches never cross a 4 KB page. A prefetched block is useful if a demand
+   access hits it at least pf_latency accesses after it was issued, late
+   if one hits it earlier. A late first use still waits for the block,
+   so it is counted as a miss rather than a hit. A prefetch is
+   polluting if a demand access misses on the block it evicted. */
+//硬件预取器
+typedef enum { PREFETCH_NONE, PREFETCH_NEXT, PREFETCH_STRIDE, PREFETCH_STREAM } prefetch_t;
+
+const char* prefetch_names[] = { "none", "next", "stride", "stream" };
+
+#define PF_PAGE_BITS 12         //预取不跨越4KB页
+#define PF_STRIDE_ENTRIES 64    //步长表项数，按区域号直接映射
+#define PF_STREAMS 16           //同时跟踪的流数
+#define PF_STREAM_WINDOW 4      //离流的最后一块不超过4块的不命中属于该流
+#define PF_INFLIGHT 64          //记录最近发出的预取，用于判断是否太迟
+#define PF_FILTER_SIZE 1024     //被预取驱逐的块，用于判断污染
+
+/* Type: state of one prefetcher */
+typedef struct pf_stride {
+    mem_addr_t region;      //区域号+1，0表示空
+    mem_addr_t last;        //该区域上次访问的地址
+    long long int stride;   //上次的步长
+    int confirmed;          //步长连续出现过两次
+} pf_stride_t;
+
+typedef struct pf_stream {
+    mem_addr_t last;        //流的最后一块
+    int dir;                //1升序，-1降序，0还不知道方向
+    unsigned long long int used;    //最近使用的时间，0表示空
+} pf_stream_t;
+
+typedef struct prefetcher {
+    pf_stride_t stride[PF_STRIDE_ENTRIES];
+    pf_stream_t streams[PF_STREAMS];
+    mem_addr_t inflight[PF_INFLIGHT];   //最近预取的块
+    unsigned long long int ready[PF_INFLIGHT];  //这些块到达的时间
+    int inflight_next;
+    mem_addr_t filter[PF_FILTER_SIZE];  //被预取驱逐的块号+1
+} prefetcher_t;
+
+/* Type: one simulated cache and its statistics */
+//一个被模拟的cache及其统计信息
+typedef struct cache {
+    int s, E, b;    //组索引位数、每组行数、块偏移位数
+    int S;          //组数
+    cache_word_t* sets;     //按64字节对齐后的cache起始地址
+    void* block;            //malloc返回的原始指针，用于释放
+    policy_t policy;        //替换策略
+    int write_through;      //写直达，否则写回
+    int write_allocate;     //写不命中时分配行
+    prefetch_t prefetch;    //预取器
+    prefetcher_t* pf;       //预取器状态，不预取时为NULL
+    int pf_words;           //每组预取位图占用的字数，不预取时为0
+    int valid_words;        //每组有效位图（以及脏位图）占用的字数
+    int state_words;        //每组策略位占用的字数
+    int way_words;          //每组中每行策略状态占用的字数
+    int set_words;          //每组记录占用的字数（含填充）
+    mem_addr_t set_index_mask;
+    unsigned long long int lru_counter; //一个记录最后一次访问时间的值，越小越早访问
+    unsigned long long int rng;         //随机替换和BRRIP使用的xorshift状态
+    unsigned long long int hit_count;       //命中次数
+    unsigned long long int miss_count;      //不命中次数
+    unsigned long long int eviction_count;  //驱逐次数
+    unsigned long long int invalidation_count;  //因下级驱逐而被作废的块数（包含式层次）
+    unsigned long long int dirty_count;     //被驱逐的脏块数
+    unsigned long long int write_bytes;     //直接写到下一级的字节数，不含脏块写回
+    unsigned long long int split_count;     //跨越块边界而被拆分的访问数
+    unsigned long long int prefetch_count;  //发出的预取数
+    unsigned long long int pf_eviction_count;   //预取填充造成的驱逐数，不计入eviction_count
+    unsigned long long int useful_count;    //及时且被用到的预取数
+    unsigned long long int late_count;      //被用到但到达太迟的预取数
+    unsigned long long int polluting_count; //驱逐的块随后又被访问的预取数
+} cache_t;
+
+/* Globals set by command line args */
+//命令行设置的参数
+int verbosity = 0; /* print trace if set */ //显示轨迹信息
+int s = -1; /* set index bits, 0 for fully associative */     //设置内存中组索引的位数
+int b = 0; /* block offset bits */  //内存块中地址的位数（块偏移位数）
+int E = 0; /* associativity */  //每组中的缓存行数
+char* trace_file = NULL;    //trace_file的char指针
+int bench_reps = 0; /* time this many in-memory replays if set */   //基准测试的重放次数
+char* config_spec = NULL; /* simulate a list of configurations if set */    //多配置模式的配置列表
+int num_threads = 1; /* worker threads for the configuration list */    //多配置模式的工作线程数
+int stack_mode = 0; /* print the LRU miss curve over E if set */    //栈距离分析模式
+policy_t policy = POLICY_LRU; /* replacement policy */  //替换策略
+int write_policy = 0; /* WRITE_THROUGH and WRITE_NO_ALLOCATE flags */  //写策略
+int write_stats = 0; /* print the write counters if set */  //输出写回统计
+int split_lines = 0; /* split accesses that cross a block boundary if set */   //拆分跨块访问
+char* hierarchy_spec = NULL; /* simulate a cache hierarchy if set */   //多级cache的配置
+prefetch_t prefetch = PREFETCH_NONE; /* prefetcher */    //预取器
+int pf_degree = 2; /* blocks or strides prefetched ahead */   //预取深度
+int pf_latency = 16; /* accesses a prefetch takes to arrive */ //预取的延迟（以访问次数计）
+
+/* Derived from command line args */
+int S; /* number of sets 缓存中的组个数*/
+int B; /* block size (bytes) 高速缓存块的字节数*/
+
+/* The cache we are simulating */
+//主缓存
+cache_t cache;
+
+/* 
+ * initCache - Allocate memory, write 0's for valid and tag and LRU
+ * also computes the set_index_mask
+ * 初始化缓存，将缓存中的所有数据位置0，同时计算set_index_mask
+ */
+void initCache(cache_t* c, int s, int E, int b, policy_t policy, int write,
+               prefetch_t prefetch)
+{
+    size_t bytes;
+    memset(c, 0, sizeof(*c));
+    c->s = s;
+    c->E = E;
+    c->b = b;
+    c->S = 1 << s;
+    c->policy = policy;
+    c->write_through = (write & WRITE_THROUGH) != 0;
+    c->write_allocate = (write & WRITE_NO_ALLOCATE) == 0;
+    c->prefetch = prefetch;
+    c->lru_counter = 1;
+    c->rng = 0x2545f4914f6cdd1dULL;
+    c->valid_words = (E + 63) / 64;    //每64路一个有效位图字
+    if(prefetch != PREFETCH_NONE)
+    {
+        c->pf_words = c->valid_words;
+        c->pf = calloc(1, sizeof(prefetcher_t));
+    }
+    switch(policy)  //各策略的状态大小
+    {
+    case POLICY_LRU:
+    case POLICY_FIFO:
+        c->way_words = E;   //每行一个64位时间戳
+        break;
+    case POLICY_LFU:
+        c->way_words = (E + 1) / 2; //每行一个32位计数
+        break;
+    case POLICY_PLRU:
+    case POLICY_BITPLRU:
+        c->state_words = (E + 63) / 64; //每组E位
+        break;
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+        c->state_words = (2 * E + 63) / 64; //每行2位
+        break;
+    case POLICY_RANDOM:
+        break;
+    }
+    if(policy == POLICY_PLRU && (E & (E - 1)))
+    {
+        fprintf(stderr, "csim: plru needs E to be a power of 2\n");
+        exit(1);
+    }
+    c->set_words = 2 * c->valid_words + c->pf_words + c->state_words + E + c->way_words;
+    //不超过64字节的组记录补齐到2的幂，否则补齐到64字节的整数倍，避免组记录跨越多余的主机缓存行
+    if(c->set_words <= 8)
+    {
+        while(c->set_words & (c->set_words - 1))
+            c->set_words ++;
+    }
+    else
+    {
+        c->set_words = (c->set_words + 7) & ~7;
+    }
+
+    bytes = (size_t)c->S * c->set_words * sizeof(cache_word_t);
+    c->block = malloc(bytes + 63);   //只分配一次
+    if(c->block == NULL || (prefetch != PREFETCH_NONE && c->pf == NULL))
+    {
+        fprintf(stderr, "csim: cannot allocate %zu bytes for the cache\n", bytes);
+        exit(1);
+    }
+    c->sets = (cache_word_t*)(((size_t)c->block + 63) & ~(size_t)63);
+    memset(c->sets, 0, bytes);
+    c->set_index_mask = (mem_addr_t)c->S - 1;
+}
+
+
+/* 
+ * freeCache - free allocated memory
+ * 释放分配的内存
+ */
+void freeCache(cache_t* c)
+{
+    free(c->block);
+    free(c->pf);
+}
+
+/*
+ * bytesWritten - bytes a cache wrote to the next level: a block per dirty
+ *   eviction plus the stores it passed straight on
+ */
+unsigned long long int bytesWritten(const cache_t* c)
+{
+    return (c->dirty_count << c->b) + c->write_bytes;
+}
+
+
+/*
+ * findWay - Look for tag in a set and choose a victim in the same pass.
+ *   Returns the way holding tag, or -1 on a miss with *victim set to the
+ *   way with the smallest LRU stamp (lowest index on ties), which is the
+ *   first empty way if the set has one. Stamps stay below 2^63, so the
+ *   signed vector compares are safe.
+ * 一次遍历同时完成标记比较、空行检测和LRU替换行的选择
+ */
+static inline int findWay(const cache_word_t* valid, const mem_addr_t* tags,
+                          const cache_word_t* lru, int E, mem_addr_t tag, int* victim)
+{
+    int i = 0;
+    int minIndex = 0;
+    cache_word_t minTime = lru[0];
+
+#if defined(__AVX2__)
+    if(E >= 4)
+    {
+        __m256i vtag = _mm256_set1_epi64x((long long)tag);
+        __m256i vmin = _mm256_set1_epi64x(LLONG_MAX);
+        __m256i vidx = _mm256_setzero_si256();
+        __m256i cur = _mm256_setr_epi64x(0, 1, 2, 3);
+        __m256i four = _mm256_set1_epi64x(4);
+        long long lane_min[4], lane_idx[4];
+        int mask, j;
+
+        for(; i + 4 <= E; i += 4)
+        {
+            __m256i t = _mm256_loadu_si256((const __m256i*)&tags[i]);
+            __m256i a = _mm256_loadu_si256((const __m256i*)&lru[i]);
+            __m256i lt = _mm256_cmpgt_epi64(vmin, a);
+            //4路同时比较标记，并与这4路的有效位相与
+            mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(t, vtag)));
+            mask &= valid[i >> 6] >> (i & 63);
+            if(mask & 0xf)
+                return i + __builtin_ctz(mask);
+            //每个通道各自保留最小的LRU时间及其下标
+            vmin = _mm256_blendv_epi8(vmin, a, lt);
+            vidx = _mm256_blendv_epi8(vidx, cur, lt);
+            cur = _mm256_add_epi64(cur, four);
+        }
+
+        _mm256_storeu_si256((__m256i*)lane_min, vmin);
+        _mm256_storeu_si256((__m256i*)lane_idx, vidx);
+        minTime = lane_min[0];
+        minIndex = lane_idx[0];
+        for(j = 1; j < 4; j ++)
+        {
+            if((cache_word_t)lane_min[j] < minTime ||
+               ((cache_word_t)lane_min[j] == minTime && lane_idx[j] < minIndex))
+            {
+                minTime = lane_min[j];
+                minIndex = lane_idx[j];
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    if(E >= 2)
+    {
+        __m128i vtag = _mm_set1_epi64x((long long)tag);
+        __m128i vmin = _mm_set1_epi64x(LLONG_MAX);
+        __m128i vidx = _mm_setzero_si128();
+        __m128i cur = _mm_set_epi64x(1, 0);
+        __m128i two = _mm_set1_epi64x(2);
+        long long lane_min[2], lane_idx[2];
+        int mask;
+
+        for(; i + 2 <= E; i += 2)
+        {
+            __m128i t = _mm_loadu_si128((const __m128i*)&tags[i]);
+            __m128i a = _mm_loadu_si128((const __m128i*)&lru[i]);
+            //SSE2没有64位比较：相等用两个32位半字的结果相与，小于取差的符号位
+            __m128i eq = _mm_cmpeq_epi32(t, vtag);
+            __m128i lt = _mm_shuffle_epi32(_mm_srai_epi32(_mm_sub_epi64(a, vmin), 31),
+                                           _MM_SHUFFLE(3, 3, 1, 1));
+            eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+            mask &= valid[i >> 6] >> (i & 63);
+            if(mask & 0x3)
+                return i + __builtin_ctz(mask);
+            vmin = _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, vmin));
+            vidx = _mm_or_si128(_mm_and_si128(lt, cur), _mm_andnot_si128(lt, vidx));
+            cur = _mm_add_epi64(cur, two);
+        }
+
+        _mm_storeu_si128((__m128i*)lane_min, vmin);
+        _mm_storeu_si128((__m128i*)lane_idx, vidx);
+        minTime = lane_min[0];
+        minIndex = lane_idx[0];
+        if((cache_word_t)lane_min[1] < minTime ||
+           ((cache_word_t)lane_min[1] == minTime && lane_idx[1] < minIndex))
+        {
+            minTime = lane_min[1];
+            minIndex = lane_idx[1];
+        }
+    }
+#endif
+
+    for(; i < E; i ++) //剩余的行逐个处理
+    {
+        if(tags[i] == tag && (valid[i >> 6] >> (i & 63) & 1))
+            return i;
+        if(lru[i] < minTime)
+        {
+            minTime = lru[i];
+            minIndex = i;
+        }
+    }
+
+    *victim = minIndex;
+    return -1;
+}
+
+
+/*
+ * matchTag - Look for tag in a set; returns its way or -1. Used by the
+ *   policies whose victim does not come from a stamp (see findWay).
+ * 只比较标记，返回命中的行或-1
+ */
+static inline int matchTag(const cache_word_t* valid, const mem_addr_t* tags, int E, mem_addr_t tag)
+{
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i vtag = _mm256_set1_epi64x((long long)tag);
+    int mask;
+
+    for(; i + 4 <= E; i += 4)
+    {
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+                   _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)&tags[i]), vtag)));
+        mask &= valid[i >> 6] >> (i & 63);
+        if(mask & 0xf)
+            return i + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    __m128i vtag = _mm_set1_epi64x((long long)tag);
+    int mask;
+
+    for(; i + 2 <= E; i += 2)
+    {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)&tags[i]), vtag);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        mask &= valid[i >> 6] >> (i & 63);
+        if(mask & 0x3)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+
+    for(; i < E; i ++)
+    {
+        if(tags[i] == tag && (valid[i >> 6] >> (i & 63) & 1))
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * nextRandom - xorshift64 step of the cache's own generator
+ */
+static inline unsigned long long int nextRandom(cache_t* c)
+{
+    c->rng ^= c->rng << 13;
+    c->rng ^= c->rng >> 7;
+    c->rng ^= c->rng << 17;
+    return c->rng;
+}
+
+/*
+ * wayMask - bits of word k of a per-set bitmap that belong to real ways
+ */
+static inline cache_word_t wayMask(int E, int k, int bits_per_way)
+{
+    int left = E * bits_per_way - k * 64;
+    return left >= 64 ? ~0ULL : (1ULL << left) - 1;
+}
+
+/*
+ * chooseVictim - pick the way to evict from a full set
+ * 组已满时按替换策略选择被驱逐的行
+ */
+static int chooseVictim(cache_t* c, cache_word_t* state, cache_word_t* ways)
+{
+    int E = c->E;
+    int i, k, n;
+    unsigned int* count;
+    cache_word_t x;
+
+    switch(c->policy)
+    {
+    case POLICY_RANDOM:
+        return nextRandom(c) % E;
+
+    case POLICY_PLRU:   //从根开始沿方向位走到叶子
+        for(n = 1; n < E; )
+            n = 2 * n + (state[n >> 6] >> (n & 63) & 1);
+        return n - E;
+
+    case POLICY_BITPLRU:    //第一个MRU位为0的行
+        for(k = 0; k < c->state_words; k ++)
+        {
+            x = ~state[k] & wayMask(E, k, 1);
+            if(x)
+                return k * 64 + __builtin_ctzll(x);
+        }
+        return 0;
+
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+        for(;;)
+        {
+            int most = 0;
+            for(k = 0; k < c->state_words; k ++)    //寻找预测值为3的行
+            {
+                x = state[k] & (state[k] >> 1) & RRIP_FIELDS & wayMask(E, k, 2);
+                if(x)
+                    return k * 32 + __builtin_ctzll(x) / 2;
+            }
+            for(i = 0; i < E; i ++)
+            {
+                int v = state[i >> 5] >> (2 * (i & 31)) & 3;
+                most = v > most ? v : most;
+            }
+            //所有行的预测值一起增加，直到最大的达到3，字段之间不会进位
+            for(k = 0; k < c->state_words; k ++)
+                state[k] += (RRPV_MAX - most) * (RRIP_FIELDS & wayMask(E, k, 2));
+        }
+
+    case POLICY_LRU:
+    case POLICY_FIFO:   //时间戳最小的行
+        for(n = 0, i = 1; i < E; i ++)
+        {
+            if(ways[i] < ways[n])
+                n = i;
+        }
+        return n;
+
+    case POLICY_LFU:    //计数最小的行
+        count = (unsigned int*)ways;
+        for(n = 0, i = 1; i < E; i ++)
+        {
+            if(count[i] < count[n])
+                n = i;
+        }
+        return n;
+    }
+    return 0;
+}
+
+/*
+ * updatePolicy - update the replacement state after way i of a set was
+ *   hit (fill == 0) or filled (fill == 1)
+ * 命中或填充一行之后更新替换策略的状态
+ */
+static inline void updatePolicy(cache_t* c, cache_word_t* state, cache_word_t* ways, int i, int fill)
+{
+    int E = c->E;
+    int n, k, shift, rrpv;
+    unsigned int* count;
+
+    switch(c->policy)
+    {
+    case POLICY_LRU:
+        ways[i] = c->lru_counter;
+        break;
+
+    case POLICY_FIFO:   //只在填充时记录时间
+        if(fill)
+            ways[i] = c->lru_counter;
+        break;
+
+    case POLICY_RANDOM:
+        break;
+
+    case POLICY_PLRU:   //路径上的方向位都指向另一侧
+        for(n = i + E; n > 1; n >>= 1)
+        {
+            if(n & 1)
+                state[(n >> 1) >> 6] &= ~(1ULL << ((n >> 1) & 63));
+            else
+                state[(n >> 1) >> 6] |= 1ULL << ((n >> 1) & 63);
+        }
+        break;
+
+    case POLICY_BITPLRU:
+        state[i >> 6] |= 1ULL << (i & 63);
+        for(k = 0; k < c->state_words; k ++)    //全部置位后只保留当前行
+            if((state[k] & wayMask(E, k, 1)) != wayMask(E, k, 1))
+                return;
+        memset(state, 0, c->state_words * sizeof(cache_word_t));
+        state[i >> 6] = 1ULL << (i & 63);
+        break;
+
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+        if(!fill)
+            rrpv = 0;   //命中后预测很快会再用到
+        else if(c->policy == POLICY_SRRIP || nextRandom(c) % BRRIP_LONG == 0)
+            rrpv = RRPV_MAX - 1;
+        else
+            rrpv = RRPV_MAX;
+        shift = 2 * (i & 31);
+        state[i >> 5] = (state[i >> 5] & ~(3ULL << shift)) | (cache_word_t)rrpv << shift;
+        break;
+
+    case POLICY_LFU:
+        count = (unsigned int*)ways;
+        if(fill)
+            count[i] = 1;
+        else if(count[i] != ~0u)
+            count[i]++;
+        break;
+    }
+}
+
+
+/* Type: the parts of the set an address maps to */
+//地址所在组的各部分
+typedef struct set_ref {
+    cache_word_t* valid;    //有效位图
+    cache_word_t* dirty;    //脏位图
+    cache_word_t* pf;       //预取后还未被用到的行
+    cache_word_t* state;    //策略位
+    mem_addr_t* tags;       //标记数组
+    cache_word_t* ways;     //每行的策略状态
+    mem_addr_t index;       //组索引
+    mem_addr_t tag;         //标记
+} set_ref_t;
+
+/* Type: a block evicted by a fill */
+//被驱逐的块
+typedef struct evict {
+    mem_addr_t addr;        //块地址，NO_BLOCK表示没有驱逐
+    int dirty;              //是否为脏块
+} evict_t;
+
+/* No block was evicted */
+#define NO_BLOCK (~0ULL)
+
+/*
+ * locateSet - find the set of addr
+ */
+static inline void locateSet(cache_t* c, mem_addr_t addr, set_ref_t* r)
+{
+    r->index = (addr >> c->b) & c->set_index_mask;   //组索引
+    r->tag = addr >> (c->s + c->b);    //标记
+    r->valid = c->sets + r->index * c->set_words;
+    r->dirty = r->valid + c->valid_words;
+    r->pf = r->dirty + c->valid_words;
+    r->state = r->pf + c->pf_words;
+    r->tags = r->state + c->state_words;
+    r->ways = r->tags + c->E;
+}
+
+static inline int isValid(const set_ref_t* r, int i)
+{
+    return r->valid[i >> 6] >> (i & 63) & 1;
+}
+
+static inline int isDirty(const set_ref_t* r, int i)
+{
+    return r->dirty[i >> 6] >> (i & 63) & 1;
+}
+
+/*
+ * findVictim - the first empty way of a set, or the policy's victim
+ */
+static inline int findVictim(cache_t* c, set_ref_t* r)
+{
+    int k;
+    for(k = 0; k < c->valid_words; k ++)   //优先使用第一个空行
+    {
+        cache_word_t empty = ~r->valid[k] & wayMask(c->E, k, 1);
+        if(empty)
+            return k * 64 + __builtin_ctzll(empty);
+    }
+    return chooseVictim(c, r->state, r->ways);
+}
+
+/*
+ * fillWay - put the block of r->tag into way i, dirty if dirty is 1,
+ *   counting an eviction if the way held a block, whose address is
+ *   stored in *victim if asked. A dirty victim is written back.
+ * 把块放入第i行，若该行有效则驱逐原来的块，脏块需要写回
+ */
+static inline void fillWay(cache_t* c, set_ref_t* r, int i, int dirty_in, evict_t* victim)
+{
+    cache_word_t bit = 1ULL << (i & 63);
+    int dirty = 0;
+
+    if(isValid(r, i))   //选中的不是空块，驱逐该块
+    {
+        c->eviction_count++;   //驱逐次数++
+        dirty = isDirty(r, i);
+        c->dirty_count += dirty;    //脏块写回下一级，不用分支以免随机访问时预测失败
+        if(victim)
+            victim->addr = (r->tags[i] << (c->s + c->b)) | (r->index << c->b);
+    }
+    else if(victim)
+    {
+        victim->addr = NO_BLOCK;
+    }
+    if(victim)
+        victim->dirty = dirty;
+
+    r->valid[i >> 6] |= bit;    //该块有效
+    r->dirty[i >> 6] = (r->dirty[i >> 6] & ~bit) | ((cache_word_t)dirty_in << (i & 63));
+    if(c->pf_words)
+        r->pf[i >> 6] &= ~bit;
+    r->tags[i] = r->tag;   //写入块标记
+    updatePolicy(c, r->state, r->ways, i, 1);
+}
+
+/*
+ * writeWay - store len bytes into way i: a write-through cache sends
+ *   them to the next level, a write-back cache marks the line dirty
+ */
+static inline void writeWay(cache_t* c, set_ref_t* r, int i, unsigned int len)
+{
+    if(c->write_through)
+        c->write_bytes += len;
+    else
+        r->dirty[i >> 6] |= 1ULL << (i & 63);
+}
+
+/*
+ * cacheAccess - Access data at memory address addr. 按照内存访问数据
+ *   If it is already in cache, increast hit_count  如果已经在cache中了，hit_cache++
+ *   If it is not in cache, bring it in cache, increase miss count. 如果不在cache中，把它放入cache中，miss_count++
+ *   Also increase eviction_count if a line is evicted. 同时如果一个行被驱逐时，eviction_count++
+ *   A store of len bytes is an access with len > 0; on a miss it fills a
+ *   line only in a write-allocate cache, otherwise it goes straight to
+ *   the next level. Returns 1 on a hit. If victim is not NULL, it
+ *   receives the evicted block, or NO_BLOCK.
+ */
+static inline int cacheAccess(cache_t* c, mem_addr_t addr, unsigned int len, evict_t* victim)
+{
+    set_ref_t r;
+    int replaceIndex = 0;   //空位或被替换的行
+    int i;
+
+    locateSet(c, addr, &r);
+    c->lru_counter++;  //时间++
+    if(c->policy == POLICY_LRU || c->policy == POLICY_FIFO)
+    {
+        //时间戳最小的行就是空行或被替换的行，一遍完成
+        i = findWay(r.valid, r.tags, r.ways, c->E, r.tag, &replaceIndex);
+    }
+    else
+    {
+        i = matchTag(r.valid, r.tags, c->E, r.tag);
+        if(i < 0)
+            replaceIndex = findVictim(c, &r);
+    }
+
+    if(i >= 0)  //命中
+    {
+        c->hit_count++;    //命中次数++
+        updatePolicy(c, r.state, r.ways, i, 0);
+        if(len)     //命中的多为装入，分支比无条件写脏位图更快
+            writeWay(c, &r, i, len);
+        if(victim)
+            victim->addr = NO_BLOCK;
+        return 1;
+    }
+
+    c->miss_count++;   //不命中次数++
+    if(!c->write_allocate && len)   //写不分配，直接写到下一级
+    {
+        c->write_bytes += len;
+        if(victim)
+            victim->addr = NO_BLOCK;
+        return 0;
+    }
+    //写回cache中新行因这次写而变脏，写直达cache把写的字节传给下一级
+    fillWay(c, &r, replaceIndex, (len != 0) & !c->write_through, victim);
+    if(c->write_through)
+        c->write_bytes += len;
+    return 0;
+}
+
+/*
+ * cachePrefetch - fill the block of addr if it is not cached, marking it
+ *   as prefetched. Nothing is counted as an access; the victim, if any,
+ *   goes into the pollution filter.
+ * 预取一块：不命中时填入cache并标记为预取
+ */
+static void cachePrefetch(cache_t* c, mem_addr_t addr, unsigned long long int now)
+{
+    prefetcher_t* p = c->pf;
+    set_ref_t r;
+    evict_t v;
+    int i;
+
+    locateSet(c, addr, &r);
+    if(matchTag(r.valid, r.tags, c->E, r.tag) >= 0)    //已在cache中
+        return;
+    c->lru_counter++;
+    i = findVictim(c, &r);
+    fillWay(c, &r, i, 0, &v);
+    r.pf[i >> 6] |= 1ULL << (i & 63);
+    c->prefetch_count++;
+    if(v.addr != NO_BLOCK)
+    {
+        c->eviction_count--;    //fillWay已算作驱逐，改记到预取的驱逐数上
+        c->pf_eviction_count++;
+        p->filter[(v.addr >> c->b) & (PF_FILTER_SIZE - 1)] = (v.addr >> c->b) + 1;
+    }
+    p->inflight[p->inflight_next] = addr >> c->b;
+    p->ready[p->inflight_next] = now + pf_latency;
+    p->inflight_next = (p->inflight_next + 1) % PF_INFLIGHT;
+}
+
+/*
+ * prefetchBlock - prefetch block number target on behalf of an access to
+ *   block number from, unless that would cross a page
+ */
+static void prefetchBlock(cache_t* c, mem_addr_t target, mem_addr_t from,
+                          unsigned long long int now)
+{
+    int page_shift = PF_PAGE_BITS > c->b ? PF_PAGE_BITS - c->b : 0;
+
+    if((target ^ from) >> page_shift)  //不跨页
+        return;
+    cachePrefetch(c, target << c->b, now);
+}
+
+/*
+ * strideTrain - learn the stride of addr's region and prefetch along it
+ */
+static void strideTrain(cache_t* c, mem_addr_t addr, unsigned long long int now)
+{
+    mem_addr_t region = addr >> PF_PAGE_BITS;
+    pf_stride_t* e = &c->pf->stride[region & (PF_STRIDE_ENTRIES - 1)];
+    long long int d;
+    int k;
+
+    if(e->region != region + 1)     //新的区域，重新学习
+    {
+        e->region = region + 1;
+        e->last = addr;
+        e->stride = 0;
+        e->confirmed = 0;
+        return;
+    }
+    d = (long long int)(addr - e->last);
+    if(d == 0)
+        return;
+    e->confirmed = d == e->stride;
+    e->stride = d;
+    e->last = addr;
+    if(!e->confirmed)
+        return;
+    for(k = 1; k <= pf_degree; k ++)
+    {
+        mem_addr_t target = (addr + k * d) >> c->b;
+        if(target != addr >> c->b)
+            prefetchBlock(c, target, addr >> c->b, now);
+    }
+}
+
+/*
+ * streamTrain - extend the stream that block number block continues, or
+ *   start a new one in place of the least recently used stream
+ */
+static void streamTrain(cache_t* c, mem_addr_t block, unsigned long long int now)
+{
+    pf_stream_t* streams = c->pf->streams;
+    int page_shift = PF_PAGE_BITS > c->b ? PF_PAGE_BITS - c->b : 0;
+    int j, k, oldest = 0;
+
+    for(j = 0; j < PF_STREAMS; j ++)
+    {
+        pf_stream_t* st = &streams[j];
+        long long int d = (long long int)(block - st->last);
+
+        if(st->used < streams[oldest].used)
+            oldest = j;
+        if(st->used == 0 || d == 0 || (block ^ st->last) >> page_shift)
+            continue;
+        if(st->dir == 0 ? d >= -PF_STREAM_WINDOW && d <= PF_STREAM_WINDOW
+                        : d * st->dir > 0 && d * st->dir <= PF_STREAM_WINDOW)
+        {
+            if(st->dir == 0)    //第二次不命中确定方向
+                st->dir = d > 0 ? 1 : -1;
+            st->last = block;
+            st->used = now;
+            for(k = 1; k <= pf_degree; k ++)
+                prefetchBlock(c, block + k * st->dir, block, now);
+            return;
+        }
+    }
+    streams[oldest].last = block;
+    streams[oldest].dir = 0;
+    streams[oldest].used = now;
+}
+
+/*
+ * usedPrefetch - whether a hit on addr is the first use of a prefetched
+ *   block; clears the mark if it is
+ */
+static int usedPrefetch(cache_t* c, mem_addr_t addr)
+{
+    set_ref_t r;
+    int i;
+
+    locateSet(c, addr, &r);
+    i = matchTag(r.valid, r.tags, c->E, r.tag);
+    if(i < 0 || !(r.pf[i >> 6] >> (i & 63) & 1))
+        return 0;
+    r.pf[i >> 6] &= ~(1ULL << (i & 63));
+    return 1;
+}
+
+/*
+ * prefetchAccess - account for a demand access to addr that hit or
+ *   missed, and let the prefetcher react to it. The prefetch bookkeeping
+ *   stays out of cacheAccess so that it costs nothing without -p.
+ * 统计预取的效果并训练预取器
+ */
+void prefetchAccess(cache_t* c, mem_addr_t addr, int hit)
+{
+    prefetcher_t* p = c->pf;
+    mem_addr_t block = addr >> c->b;
+    unsigned long long int now = c->hit_count + c->miss_count;
+    int j, k;
+
+    if(hit && usedPrefetch(c, addr))
+        hit = 2;    //预取的块第一次被用到
+    if(hit == 2)    //看它是否已经到达
+    {
+        for(j = 0; j < PF_INFLIGHT; j ++)
+            if(p->inflight[j] == block && p->ready[j] > now)
+                break;
+        if(j < PF_INFLIGHT)
+        {
+            c->late_count++;
+            c->hit_count--;     //还在路上的块要等，按不命中计
+            c->miss_count++;
+        }
+        else
+            c->useful_count++;
+    }
+    else if(hit == 0 && p->filter[block & (PF_FILTER_SIZE - 1)] == block + 1)
+    {
+        c->polluting_count++;   //该块是被预取驱逐的
+        p->filter[block & (PF_FILTER_SIZE - 1)] = 0;
+    }
+
+    switch(c->prefetch)
+    {
+    case PREFETCH_NEXT:
+        if(hit != 1)
+        {
+            for(k = 1; k <= pf_degree; k ++)
+                prefetchBlock(c, block + k, block, now);
+        }
+        break;
+    case PREFETCH_STRIDE:
+        strideTrain(c, addr, now);
+        break;
+    case PREFETCH_STREAM:
+        if(hit != 1)
+            streamTrain(c, block, now);
+        break;
+    case PREFETCH_NONE:
+        break;
+    }
+}
+
+/*
+ * accessData - access addr in a single cache, see cacheAccess, and run
+ *   its prefetcher
+ */
+void accessData(cache_t* c, mem_addr_t addr, unsigned int len)
+{
+    int hit = cacheAccess(c, addr, len, NULL);
+
+    if(c->pf)
+        prefetchAccess(c, addr, hit);
+}
+
+/*
+ * dropWay - invalidate way i of a set
+ */
+static inline void dropWay(cache_t* c, set_ref_t* r, int i)
+{
+    r->valid[i >> 6] &= ~(1ULL << (i & 63));
+    r->dirty[i >> 6] &= ~(1ULL << (i & 63));
+    if(c->pf_words)
+        r->pf[i >> 6] &= ~(1ULL << (i & 63));
+    if(c->policy == POLICY_LRU || c->policy == POLICY_FIFO)
+        r->ways[i] = 0;     //保持空行时间戳为0
+}
+
+/*
+ * cacheLookup - count a hit or a miss for addr without allocating on a
+ *   miss. On a hit the block is removed if remove is set, otherwise its
+ *   replacement state is updated. Returns 1 on a hit, 2 if the block hit
+ *   was dirty.
+ * 只查找不分配，用于互斥的下级cache
+ */
+static int cacheLookup(cache_t* c, mem_addr_t addr, int remove)
+{
+    set_ref_t r;
+    int i, hit;
+
+    locateSet(c, addr, &r);
+    c->lru_counter++;
+    i = matchTag(r.valid, r.tags, c->E, r.tag);
+    if(i < 0)
+    {
+        c->miss_count++;
+        return 0;
+    }
+
+    c->hit_count++;
+    hit = 1 + isDirty(&r, i);
+    if(remove)
+        dropWay(c, &r, i);
+    else
+        updatePolicy(c, r.state, r.ways, i, 0);
+    return hit;
+}
+
+/*
+ * cacheInsert - place the block of addr without counting an access, as
+ *   when a victim of the level above moves down, dirty if it was dirty
+ *   there. Returns 1 and sets *victim if that evicted a block.
+ */
+static int cacheInsert(cache_t* c, mem_addr_t addr, int dirty, evict_t* victim)
+{
+    set_ref_t r;
+    int i;
+
+    locateSet(c, addr, &r);
+    c->lru_counter++;
+    i = matchTag(r.valid, r.tags, c->E, r.tag);
+    if(i < 0)
+    {
+        fillWay(c, &r, findVictim(c, &r), dirty, victim);
+        return victim->addr != NO_BLOCK;
+    }
+    victim->addr = NO_BLOCK;
+    if(dirty)
+        r.dirty[i >> 6] |= 1ULL << (i & 63);
+    return 0;
+}
+
+/*
+ * cacheWriteback - take a dirty block written back by the level above.
+ *   A write-back cache holding the block marks it dirty, and one that
+ *   allocates on writes fills it like cacheInsert; either way it returns
+ *   1. Otherwise the block passes through to the next level and 0 is
+ *   returned.
+ * 接收上级写回的脏块
+ */
+static int cacheWriteback(cache_t* c, mem_addr_t addr, evict_t* victim)
+{
+    set_ref_t r;
+    int i;
+
+    victim->addr = NO_BLOCK;
+    if(!c->write_through)
+    {
+        locateSet(c, addr, &r);
+        i = matchTag(r.valid, r.tags, c->E, r.tag);
+        if(i >= 0)
+        {
+            r.dirty[i >> 6] |= 1ULL << (i & 63);
+            return 1;
+        }
+        if(c->write_allocate)
+        {
+            cacheInsert(c, addr, 1, victim);
+            return 1;
+        }
+    }
+    c->write_bytes += 1ULL << c->b;     //原样写到下一级
+    return 0;
+}
+
+/*
+ * cacheInvalidate - drop the block of addr if present; returns 1 if it was,
+ *   2 if it was dirty, in which case it is written back
+ */
+static int cacheInvalidate(cache_t* c, mem_addr_t addr)
+{
+    set_ref_t r;
+    int i;
+
+    locateSet(c, addr, &r);
+    i = matchTag(r.valid, r.tags, c->E, r.tag);
+    if(i < 0)
+        return 0;
+    if(isDirty(&r, i))
+    {
+        c->dirty_count++;
+        dropWay(c, &r, i);
+        return 2;
+    }
+    dropWay(c, &r, i);
+    return 1;
+}
+
+
+/*
+ * crossesBlock - whether the len bytes at addr span more than one block
+ */
+static inline int crossesBlock(mem_addr_t addr, unsigned int len, int b)
+{
+    return (addr & ((1ULL << b) - 1)) + len > (1ULL << b);
+}
+
+/*
+ * splitAccess - access every block that the len bytes at addr touch, once
+ *   each; a store writes the part of the bytes that falls in each block
+ * 把跨块的访问拆成每块一次
+ */
+static void splitAccess(cache_t* c, mem_addr_t addr, unsigned int len, int store)
+{
+    mem_addr_t end = addr + len, next;
+
+    for(; addr < end; addr = next)
+    {
+        next = ((addr >> c->b) + 1) << c->b;   //下一块的起始地址
+        if(next > end)
+            next = end;
+        accessData(c, addr, store ? (unsigned int)(next - addr) : 0);
+    }
+}
+
+/*
+ * accessRecord - replay one trace record: L loads and S stores the data,
+ *   M (a load followed by a store) accesses it twice. With split_lines,
+ *   a record crossing a block boundary accesses every block it touches.
+ * 重放一条访存记录，M访问两次
+ */
+static inline void accessRecord(cache_t* c, const trace_rec_t* rec)
+{
+    unsigned int len = rec->len ? rec->len : 1;   //写入的字节数
+
+    if(split_lines && crossesBlock(rec->addr, len, c->b))
+    {
+        c->split_count++;
+        if(rec->op != 'S')
+            splitAccess(c, rec->addr, len, 0);
+        if(rec->op != 'L')
+            splitAccess(c, rec->addr, len, 1);
+        return;
+    }
+    accessData(c, rec->addr, rec->op == 'S' ? len : 0);
+    if(rec->op == 'M')
+        accessData(c, rec->addr, len);
+}
+
+
+/*
+ * replayTrace - replays the given trace file against the cache 
+ */
+void replayTrace(char* trace_fn)
+{
+    trace_t trace;
+    trace_rec_t rec;
+
+    traceOpen(&trace, trace_fn);    //映射trace文件，文本或二进制格式
+    while(traceNext(&trace, &rec)) {
+        if(verbosity)
+            printf("%c %llx,%u ", rec.op, rec.addr, rec.len);
+
+        /* If the instruction is R/W then access again */
+        accessRecord(&cache, &rec);
+
+        if (verbosity)
+            printf("\n");
+    }
+
+    traceClose(&trace);
+}
+
+/*
+ * loadTrace - read every data access of the trace into memory so that
+ *     the benchmark times the simulator and not the parser
+ * 把trace中的访存记录读入内存，返回记录数
+ */
+size_t loadTrace(char* trace_fn, trace_rec_t** recs)
+{
+    trace_t trace;
+    size_t n = 0, cap = 1024;
+
+    traceOpen(&trace, trace_fn);
+    *recs = malloc(cap * sizeof(trace_rec_t));
+    while(traceNext(&trace, &(*recs)[n])) {
+        if(++n == cap)  //空间不足时倍增
+        {
+            cap *= 2;
+            *recs = realloc(*recs, cap * sizeof(trace_rec_t));
+        }
+    }
+
+    traceClose(&trace);
+    return n;
+}
+
+/*
+ * benchTrace - replay the in-memory trace bench_reps times against a
+ *     freshly initialized cache and report simulated accesses per second
+ *     on stderr. The counters left behind are those of the last replay,
+ *     so the summary matches a normal run.
+ * 基准测试：重复重放bench_reps次，在stderr上输出每秒模拟的访问次数
+ */
+void benchTrace(char* trace_fn)
+{
+    trace_rec_t* recs;
+    size_t n = loadTrace(trace_fn, &recs);
+    size_t i = 0;
+    unsigned long long int accesses = 0;
+    double secs = 0;
+    clock_t start;
+    int rep = 0;
+
+    for(rep = 0; rep < bench_reps; rep ++)
+    {
+        freeCache(&cache);  //每次重放都从空cache开始
+        initCache(&cache, s, E, b, policy, write_policy, prefetch);
+
+        start = clock();
+        for(i = 0; i < n; i ++)
+            accessRecord(&cache, &recs[i]);
+        secs += (double)(clock() - start) / CLOCKS_PER_SEC;
+        accesses += cache.hit_count + cache.miss_count;
+    }
+
+    fprintf(stderr, "csim: %llu accesses in %.3f s, %.2f M accesses/s\n",
+            accesses, secs, secs > 0 ? accesses / secs / 1e6 : 0.0);
+    free(recs);
+}
+
+/* Limits of the -c multi-configuration mode */
+#define MAX_CONFIGS 4096    //一次最多模拟的配置数
+#define CHUNK_RECS 65536    //每次解析并分发的记录数
+
+/* Chunks of parsed records shared with the worker threads */
+//主线程解析到一个缓冲区时，工作线程模拟另一个缓冲区
+trace_rec_t* chunk_recs[2];
+size_t chunk_len[2];
+pthread_barrier_t chunk_barrier;
+
+/* Type: the caches simulated by one worker thread */
+typedef struct worker {
+    pthread_t tid;
+    cache_t* caches;    //该线程负责的第一个cache
+    int n;              //cache个数
+} worker_t;
+
+/*
+ * parseField - parse one field of a configuration: a number, an inclusive
+ *   range lo-hi, or a list of those separated by '/'. Returns the number
+ *   of values stored in vals, or -1 if the field is malformed.
+ * 解析配置的一个字段，如 4、2-8 或 1/2/4
+ */
+static int parseField(const char* f, int* vals, int max)
+{
+    char* end;
+    long lo, hi;
+    int n = 0;
+
+    for(;;)
+    {
+        lo = hi = strtol(f, &end, 10);
+        if(end == f)
+            return -1;
+        if(*end == '-')
+        {
+            f = end + 1;
+            hi = strtol(f, &end, 10);
+            if(end == f || hi < lo)
+                return -1;
+        }
+        for(; lo <= hi; lo ++)
+        {
+            if(n == max)
+                return -1;
+            vals[n++] = lo;
+        }
+        if(*end != '/')
+            break;
+        f = end + 1;
+    }
+    return *end == '\0' ? n : -1;
+}
+
+/*
+ * parseConfigs - expand a list of s:E:b configurations separated by ','
+ *   into caches, taking every combination of the values of each field
+ * 把形如 "2-6:1/2/4:4,8:1:5" 的配置列表展开为各个cache，返回cache个数
+ */
+int parseConfigs(char* spec, cache_t** caches)
+{
+    char* copy = strdup(spec);
+    char *cfg, *field, *save1, *save2;
+    int vals[3][64], nvals[3];
+    int n = 0, k, i, j, l;
+
+    *caches = malloc(MAX_CONFIGS * sizeof(cache_t));
+    for(cfg = strtok_r(copy, ",", &save1); cfg != NULL; cfg = strtok_r(NULL, ",", &save1))
+    {
+        for(k = 0, field = strtok_r(cfg, ":", &save2); field != NULL && k < 3;
+            k ++, field = strtok_r(NULL, ":", &save2))
+        {
+            nvals[k] = parseField(field, vals[k], 64);
+            if(nvals[k] < 0)
+                break;
+        }
+        if(k != 3 || field != NULL)
+        {
+            fprintf(stderr, "csim: bad configuration list '%s', expected s:E:b,...\n", spec);
+            exit(1);
+        }
+
+        for(i = 0; i < nvals[0]; i ++)
+            for(j = 0; j < nvals[1]; j ++)
+                for(l = 0; l < nvals[2]; l ++)
+                {
+                    if(vals[0][i] < 0 || vals[1][j] < 1 || vals[2][l] < 1 ||
+                       vals[0][i] + vals[2][l] > 40)
+                    {
+                        fprintf(stderr, "csim: bad configuration %d:%d:%d\n",
+                                vals[0][i], vals[1][j], vals[2][l]);
+                        exit(1);
+                    }
+                    if(n == MAX_CONFIGS)
+                    {
+                        fprintf(stderr, "csim: more than %d configurations\n", MAX_CONFIGS);
+                        exit(1);
+                    }
+                    initCache(&(*caches)[n++], vals[0][i], vals[1][j], vals[2][l], policy, write_policy, prefetch);
+                }
+    }
+
+    free(copy);
+    return n;
+}
+
+/*
+ * simulateChunk - replay a chunk of records against one cache
+ */
+static void simulateChunk(cache_t* c, const trace_rec_t* recs, size_t n)
+{
+    size_t i;
+    for(i = 0; i < n; i ++)
+        accessRecord(c, &recs[i]);
+}
+
+/*
+ * configWorker - simulate this worker's caches over every chunk the main
+ *   thread hands out, until it hands out an empty one
+ * 工作线程：每轮在屏障处等待主线程交出一个缓冲区，空缓冲区表示结束
+ */
+static void* configWorker(void* arg)
+{
+    worker_t* w = arg;
+    int cur = 0, i;
+
+    for(;;)
+    {
+        pthread_barrier_wait(&chunk_barrier);
+        if(chunk_len[cur] == 0)
+            break;
+        for(i = 0; i < w->n; i ++)
+            simulateChunk(&w->caches[i], chunk_recs[cur], chunk_len[cur]);
+        cur ^= 1;
+    }
+    return NULL;
+}
+
+/*
+ * fillChunk - parse up to CHUNK_RECS records of the trace into recs
+ */
+static size_t fillChunk(trace_t* trace, trace_rec_t* recs)
+{
+    size_t n = 0;
+    while(n < CHUNK_RECS && traceNext(trace, &recs[n]))
+        n++;
+    return n;
+}
+
+/*
+ * replayConfigs - parse the trace once and replay every record against
+ *   all n caches. With more than one thread the caches are split between
+ *   worker threads, which simulate one chunk while the main thread parses
+ *   the next.
+ * 只解析一遍trace，把每条记录分发给所有cache
+ */
+void replayConfigs(char* trace_fn, cache_t* caches, int n)
+{
+    trace_t trace;
+    int threads = num_threads < n ? num_threads : n;
+    worker_t* workers;
+    int cur = 0, i;
+
+    traceOpen(&trace, trace_fn);
+    chunk_recs[0] = malloc(CHUNK_RECS * sizeof(trace_rec_t));
+    chunk_recs[1] = malloc(CHUNK_RECS * sizeof(trace_rec_t));
+
+    if(threads <= 1)
+    {
+        while((chunk_len[0] = fillChunk(&trace, chunk_recs[0])) > 0)
+            for(i = 0; i < n; i ++)
+                simulateChunk(&caches[i], chunk_recs[0], chunk_len[0]);
+    }
+    else
+    {
+        workers = malloc(threads * sizeof(worker_t));
+        pthread_barrier_init(&chunk_barrier, NULL, threads + 1);
+        for(i = 0; i < threads; i ++)   //按顺序平均分配cache
+        {
+            workers[i].caches = caches + (long)n * i / threads;
+            workers[i].n = (long)n * (i + 1) / threads - (long)n * i / threads;
+            pthread_create(&workers[i].tid, NULL, configWorker, &workers[i]);
+        }
+
+        chunk_len[0] = fillChunk(&trace, chunk_recs[0]);
+        for(;;)
+        {
+            pthread_barrier_wait(&chunk_barrier);   //工作线程开始模拟chunk_recs[cur]
+            if(chunk_len[cur] == 0)
+                break;
+            chunk_len[cur ^ 1] = fillChunk(&trace, chunk_recs[cur ^ 1]);
+            cur ^= 1;
+        }
+
+        for(i = 0; i < threads; i ++)
+            pthread_join(workers[i].tid, NULL);
+        pthread_barrier_destroy(&chunk_barrier);
+        free(workers);
+    }
+
+    free(chunk_recs[0]);
+    free(chunk_recs[1]);
+    traceClose(&trace);
+}
+
+/*
+ * printConfigs - print one line of results per configuration
+ */
+void printConfigs(cache_t* caches, int n)
+{
+    int i;
+    unsigned long long int accesses;
+
+    printf("%3s %5s %3s %12s %12s %12s %12s %8s %12s %14s %12s",
+           "s", "E", "b", "bytes", "hits", "misses", "evictions", "miss%",
+           "dirty", "written", "splits");
+    if(prefetch != PREFETCH_NONE)
+        printf(" %12s %12s %12s %12s %12s", "prefetches", "useful", "late", "polluting",
+               "pf_evictions");
+    printf("\n");
+    for(i = 0; i < n; i ++)
+    {
+        cache_t* c = &caches[i];
+        accesses = c->hit_count + c->miss_count;
+        printf("%3d %5d %3d %12llu %12llu %12llu %12llu %8.3f %12llu %14llu %12llu",
+               c->s, c->E, c->b, (unsigned long long)c->S * c->E << c->b,
+               c->hit_count, c->miss_count, c->eviction_count,
+               accesses ? 100.0 * c->miss_count / accesses : 0.0,
+               c->dirty_count, bytesWritten(c), c->split_count);
+        if(prefetch != PREFETCH_NONE)
+            printf(" %12llu %12llu %12llu %12llu %12llu", c->prefetch_count,
+                   c->useful_count, c->late_count, c->polluting_count,
+                   c->pf_eviction_count);
+        printf("\n");
+    }
+}
+
+/* Cache hierarchy for the -H mode
+   hier[] holds the L1 data cache, the L1 instruction cache if there is
+   one, then the unified levels L2, L3, ... from hier_lower on. Every
+   level uses the same block size. The inclusion policy decides what the
+   lower levels hold:
+     nine       non-inclusive non-exclusive: a miss fills every level it
+                went through, and levels evict independently
+     inclusive  as nine, but a block evicted from a lower level is also
+                invalidated in every level above it
+     exclusive  a block lives in one level only: a miss fills L1 alone,
+                a lower level hit moves the block up to L1, and L1
+                victims move down one level at a time  */
+//多级cache：hier[]依次为L1D、L1I（若有）和L2、L3等统一cache
+#define MAX_LEVELS 8
+
+typedef enum { INCL_NINE, INCL_INCLUSIVE, INCL_EXCLUSIVE } inclusion_t;
+
+const char* inclusion_names[] = { "nine", "inclusive", "exclusive" };
+
+inclusion_t inclusion = INCL_NINE;  //包含策略
+cache_t hier[MAX_LEVELS];
+char hier_names[MAX_LEVELS][8];
+int hier_count;         //级数（含L1I）
+int hier_l1i = -1;      //L1I的下标，-1表示不模拟取指
+int hier_lower;         //第一个下级cache（L2）的下标
+
+/*
+ * parseHierarchy - set up the levels from a list of name=s:E:b entries
+ *   separated by ','. The names are l1d (or l1), l1i, l2, l3, ...
+ * 解析形如 "l1i=6:8:6,l1d=6:8:6,l2=10:8:6" 的层次配置
+ */
+void parseHierarchy(char* spec)
+{
+    char* copy = strdup(spec);
+    char *item, *save;
+    int ls[MAX_LEVELS + 2], lE[MAX_LEVELS + 2], lb[MAX_LEVELS + 2];
+    int level, n, i, lowest = 1;
+    int vs, vE, vb;
+
+    for(i = 0; i < MAX_LEVELS + 2; i ++)
+        lE[i] = 0;
+    //下标0为L1I，1为L1D，k为Lk（k>=2）
+    for(item = strtok_r(copy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        char name[8];
+        if(sscanf(item, "%7[^=]=%d:%d:%d%n", name, &vs, &vE, &vb, &n) != 4 ||
+           item[n] != '\0')
+            goto bad;
+        if(strcmp(name, "l1i") == 0)
+            level = 0;
+        else if(strcmp(name, "l1d") == 0 || strcmp(name, "l1") == 0)
+            level = 1;
+        else if(name[0] == 'l' && name[1] >= '2' && name[1] <= '0' + MAX_LEVELS - 1 && name[2] == '\0')
+            level = name[1] - '0';
+        else
+            goto bad;
+        if(vs < 0 || vE < 1 || vb < 1 || vs + vb > 40)
+            goto bad;
+        ls[level] = vs;
+        lE[level] = vE;
+        lb[level] = vb;
+        if(level > lowest)
+            lowest = level;
+    }
+    if(lE[1] == 0)
+        goto bad;
+
+    hier_count = 0;
+    for(level = 1; level <= lowest; level ++)
+    {
+        if(level >= 2 && lE[level] == 0)
+        {
+            fprintf(stderr, "csim: hierarchy '%s' skips level %d\n", spec, level);
+            exit(1);
+        }
+        if(lb[level] != lb[1] || (lE[0] && lb[0] != lb[1]))
+        {
+            fprintf(stderr, "csim: every level of '%s' needs the same block size\n", spec);
+            exit(1);
+        }
+        if(level == 1)  //L1D之后是L1I
+        {
+            strcpy(hier_names[hier_count], "L1D");
+            initCache(&hier[hier_count++], ls[1], lE[1], lb[1], policy, write_policy, PREFETCH_NONE);
+            if(lE[0])
+            {
+                hier_l1i = hier_count;
+                strcpy(hier_names[hier_count], "L1I");
+                initCache(&hier[hier_count++], ls[0], lE[0], lb[0], policy, write_policy, PREFETCH_NONE);
+            }
+            hier_lower = hier_count;
+            continue;
+        }
+        sprintf(hier_names[hier_count], "L%d", level);
+        initCache(&hier[hier_count++], ls[level], lE[level], lb[level], policy, write_policy, PREFETCH_NONE);
+    }
+    free(copy);
+    return;
+
+bad:
+    fprintf(stderr, "csim: bad hierarchy '%s', expected l1d=s:E:b[,l1i=s:E:b][,l2=s:E:b...]\n", spec);
+    exit(1);
+}
+
+/*
+ * hierWriteback - write a dirty block back into level k, passing it on
+ *   through the levels that do not keep it
+ * 把脏块写回第k级，不保留该块的级继续向下传递
+ */
+static void lowerVictim(int k, const evict_t* v);
+
+static void hierWriteback(int k, mem_addr_t addr)
+{
+    evict_t v;
+
+    for(; k < hier_count; k ++)
+    {
+        if(cacheWriteback(&hier[k], addr, &v))
+        {
+            if(v.addr != NO_BLOCK)
+                lowerVictim(k, &v);
+            return;
+        }
+    }
+}
+
+/*
+ * lowerVictim - handle a block evicted from level k: in an inclusive
+ *   hierarchy a lower level victim is also invalidated above, and a
+ *   dirty victim (or a dirty copy above) is written back to the level
+ *   below k
+ * 处理第k级驱逐的块：包含式层次中作废上级的副本，脏块写回下一级
+ */
+static void lowerVictim(int k, const evict_t* v)
+{
+    int j, r, dirty = v->dirty;
+
+    if(k >= hier_lower && inclusion == INCL_INCLUSIVE)
+    {
+        for(j = 0; j < k; j ++) //上级中的同一块一并作废
+        {
+            r = cacheInvalidate(&hier[j], v->addr);
+            if(r)
+                hier[j].invalidation_count++;
+            if(r == 2)
+                dirty = 1;
+        }
+    }
+    if(dirty)
+        hierWriteback(k < hier_lower ? hier_lower : k + 1, v->addr);
+}
+
+/*
+ * hierAccess - access addr through L1 cache l1 and the levels below it,
+ *   storing len bytes if len > 0. A store goes on down as a store past
+ *   every write-through level and every level that missed without
+ *   allocating; below the level that keeps it, the access is the load
+ *   that fills the line.
+ * 从给定的L1开始逐级访问
+ */
+static void hierAccess(cache_t* l1, mem_addr_t addr, unsigned int len)
+{
+    evict_t v, up;
+    int k, hit;
+
+    if(inclusion == INCL_EXCLUSIVE)     //只支持写回+写分配，见main
+    {
+        if(cacheAccess(l1, addr, len, &v))
+            return;
+        for(k = hier_lower; k < hier_count; k ++)   //下级命中时把块从该级移出
+        {
+            hit = cacheLookup(&hier[k], addr, 1);
+            if(hit)
+            {
+                if(hit == 2)    //脏块随之上移，该块已在L1中，只置脏位
+                    cacheInsert(l1, addr, 1, &up);
+                break;
+            }
+        }
+        //L1的牺牲块逐级下移，每级的牺牲块继续移到更下一级
+        for(k = hier_lower; v.addr != NO_BLOCK && k < hier_count; k ++)
+        {
+            if(!cacheInsert(&hier[k], v.addr, v.dirty, &v))
+                break;
+        }
+        return;
+    }
+
+    for(k = l1 - hier; k < hier_count; k = k < hier_lower ? hier_lower : k + 1)
+    {
+        cache_t* c = &hier[k];
+
+        hit = cacheAccess(c, addr, len, &v);
+        if(v.addr != NO_BLOCK)
+            lowerVictim(k, &v);
+        if(len && !c->write_through && (hit || c->write_allocate))
+            len = 0;    //写回cache保留了这次写
+        if(hit && len == 0)
+            break;
+    }
+}
+
+/*
+ * hierRecord - access the len bytes at addr through L1 cache l1, one
+ *   access per block they touch if split_lines is set
+ */
+static void hierRecord(cache_t* l1, mem_addr_t addr, unsigned int len, int store)
+{
+    mem_addr_t end = addr + len, next;
+
+    if(!split_lines)
+    {
+        hierAccess(l1, addr, store ? len : 0);
+        return;
+    }
+    for(; addr < end; addr = next)
+    {
+        next = ((addr >> l1->b) + 1) << l1->b;
+        if(next > end)
+            next = end;
+        hierAccess(l1, addr, store ? (unsigned int)(next - addr) : 0);
+    }
+}
+
+/*
+ * replayHierarchy - replay the trace through the hierarchy: instruction
+ *   fetches go to L1I if there is one, data accesses to L1D
+ */
+void replayHierarchy(char* trace_fn)
+{
+    trace_t trace;
+    trace_rec_t rec;
+
+    traceOpen(&trace, trace_fn);
+    trace.ifetch = hier_l1i >= 0;
+    while(traceNext(&trace, &rec)) {
+        unsigned int len = rec.len ? rec.len : 1;
+        cache_t* l1 = rec.op == 'I' ? &hier[hier_l1i] : &hier[0];
+
+        if(split_lines && crossesBlock(rec.addr, len, l1->b))
+            l1->split_count++;
+        if(rec.op == 'I')
+        {
+            hierRecord(l1, rec.addr, len, 0);
+            continue;
+        }
+        hierRecord(l1, rec.addr, len, rec.op == 'S');
+        if(rec.op == 'M')
+            hierRecord(l1, rec.addr, len, 1);
+    }
+    traceClose(&trace);
+}
+
+/* Stack distance (Mattson) analysis for the -d mode
+   Every block's most recent access is a node of an order-statistics
+   treap keyed by (set << SD_TIME_BITS | time). The LRU stack distance of
+   an access is the number of blocks of the same set used since the
+   block's previous access, i.e. the number of keys between its old key
+   and the end of the set, which the subtree sizes give in O(log n).
+   A hash table maps each block to the time of its previous access.  */
+//栈距离分析：每个块最近一次访问是treap的一个结点，键为 组号|时间
+#define SD_TIME_BITS 40     //时间戳位数，组号放在更高的位
+
+/* Type: treap node */
+typedef struct sd_node {
+    unsigned long long int key;     //组号<<SD_TIME_BITS | 最近访问时间
+    unsigned int prio;      //随机优先级
+    int left, right;        //子结点下标，0表示空
+    int size;               //子树结点数
+} sd_node_t;
+
+/* Type: hash table entry, block + 1 (0 marks an empty slot) */
+typedef struct sd_entry {
+    mem_addr_t block;
+    unsigned long long int time;
+} sd_entry_t;
+
+sd_node_t* sd_nodes;        //结点池，下标0不用
+int sd_node_count, sd_node_cap, sd_free_list, sd_root;
+sd_entry_t* sd_table;       //块号到上次访问时间的散列表
+size_t sd_table_mask, sd_table_used;
+unsigned long long int sd_time;     //全局时间
+unsigned long long int* sd_hist;    //sd_hist[d]为栈距离为d的访问次数
+size_t sd_hist_len;
+unsigned long long int sd_cold;     //冷不命中次数（首次访问）
+unsigned long long int sd_splits;   //跨块而被拆分的访问数
+unsigned int* sd_set_blocks;        //每组访问过的不同块数
+unsigned int sd_seed = 2463534242u;
+
+/*
+ * sdNewNode - take a node from the free list or the end of the pool
+ */
+static int sdNewNode(unsigned long long int key)
+{
+    int n;
+    if(sd_free_list)
+    {
+        n = sd_free_list;
+        sd_free_list = sd_nodes[n].left;
+    }
+    else
+    {
+        if(++sd_node_count == sd_node_cap)
+        {
+            sd_node_cap *= 2;
+            sd_nodes = realloc(sd_nodes, sd_node_cap * sizeof(sd_node_t));
+        }
+        n = sd_node_count;
+    }
+    sd_seed ^= sd_seed << 13;   //xorshift32
+    sd_seed ^= sd_seed >> 17;
+    sd_seed ^= sd_seed << 5;
+    sd_nodes[n].key = key;
+    sd_nodes[n].prio = sd_seed;
+    sd_nodes[n].left = sd_nodes[n].right = 0;
+    sd_nodes[n].size = 1;
+    return n;
+}
+
+static inline void sdUpdate(int n)
+{
+    sd_nodes[n].size = 1 + sd_nodes[sd_nodes[n].left].size + sd_nodes[sd_nodes[n].right].size;
+}
+
+/*
+ * sdSplit - split tree t into keys < key (*l) and keys >= key (*r)
+ */
+static void sdSplit(int t, unsigned long long int key, int* l, int* r)
+{
+    if(t == 0)
+    {
+        *l = *r = 0;
+    }
+    else if(sd_nodes[t].key < key)
+    {
+        sdSplit(sd_nodes[t].right, key, &sd_nodes[t].right, r);
+        *l = t;
+        sdUpdate(t);
+    }
+    else
+    {
+        sdSplit(sd_nodes[t].left, key, l, &sd_nodes[t].left);
+        *r = t;
+        sdUpdate(t);
+    }
+}
+
+/*
+ * sdMerge - join two trees, every key of l below every key of r
+ */
+static int sdMerge(int l, int r)
+{
+    if(l == 0 || r == 0)
+        return l ? l : r;
+    if(sd_nodes[l].prio > sd_nodes[r].prio)
+    {
+        sd_nodes[l].right = sdMerge(sd_nodes[l].right, r);
+        sdUpdate(l);
+        return l;
+    }
+    sd_nodes[r].left = sdMerge(l, sd_nodes[r].left);
+    sdUpdate(r);
+    return r;
+}
+
+/*
+ * sdRank - number of keys below key
+ */
+static int sdRank(unsigned long long int key)
+{
+    int t = sd_root, rank = 0;
+    while(t)
+    {
+        if(sd_nodes[t].key < key)
+        {
+            rank += sd_nodes[sd_nodes[t].left].size + 1;
+            t = sd_nodes[t].right;
+        }
+        else
+        {
+            t = sd_nodes[t].left;
+        }
+    }
+    return rank;
+}
+
+/*
+ * sdLookup - find the hash slot of block, inserting it if it is new
+ */
+static sd_entry_t* sdLookup(mem_addr_t block)
+{
+    size_t i;
+    sd_entry_t* old;
+    size_t old_size;
+
+    if(2 * (sd_table_used + 1) > sd_table_mask + 1)    //装填因子超过1/2时加倍
+    {
+        old = sd_table;
+        old_size = sd_table_mask + 1;
+        sd_table_mask = 2 * old_size - 1;
+        sd_table = calloc(sd_table_mask + 1, sizeof(sd_entry_t));
+        for(i = 0; i < old_size; i ++)
+        {
+            if(old[i].block)
+            {
+                size_t j = (old[i].block * 0x9e3779b97f4a7c15ULL >> 20) & sd_table_mask;
+                while(sd_table[j].block)
+                    j = (j + 1) & sd_table_mask;
+                sd_table[j] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    block++;
+    for(i = (block * 0x9e3779b97f4a7c15ULL >> 20) & sd_table_mask; sd_table[i].block; i = (i + 1) & sd_table_mask)
+    {
+        if(sd_table[i].block == block)
+            return &sd_table[i];
+    }
+    sd_table[i].block = block;
+    sd_table[i].time = 0;
+    sd_table_used++;
+    return &sd_table[i];
+}
+
+/*
+ * sdAccess - record the stack distance of one access
+ */
+static void sdAccess(mem_addr_t addr)
+{
+    mem_addr_t block = addr >> b;
+    unsigned long long int set = block & ((1ULL << s) - 1);
+    sd_entry_t* e = sdLookup(block);
+    unsigned long long int key = set << SD_TIME_BITS | ++sd_time;
+    int l, m, r;
+    size_t d;
+
+    if(e->time == 0)    //首次访问，冷不命中
+    {
+        sd_cold++;
+        sd_set_blocks[set]++;
+    }
+    else
+    {
+        unsigned long long int old = set << SD_TIME_BITS | e->time;
+        //该块之后被访问过的同组块数即为栈距离
+        d = sdRank((set + 1) << SD_TIME_BITS) - sdRank(old) - 1;
+        if(d >= sd_hist_len)
+        {
+            size_t n = sd_hist_len;
+            while(sd_hist_len <= d)
+                sd_hist_len *= 2;
+            sd_hist = realloc(sd_hist, sd_hist_len * sizeof(*sd_hist));
+            memset(sd_hist + n, 0, (sd_hist_len - n) * sizeof(*sd_hist));
+        }
+        sd_hist[d]++;
+
+        sdSplit(sd_root, old, &l, &r);  //删除旧结点
+        sdSplit(r, old + 1, &m, &r);
+        sd_nodes[m].left = sd_free_list;
+        sd_free_list = m;
+        sd_root = sdMerge(l, r);
+    }
+
+    e->time = sd_time;
+    sdSplit(sd_root, key, &l, &r);  //插入新结点，它是该组中最大的键
+    sd_root = sdMerge(sdMerge(l, sdNewNode(key)), r);
+}
+
+/*
+ * stackDistance - compute the LRU stack distance of every access of the
+ *   trace for S sets of B-byte blocks, then print the hits, misses and
+ *   evictions an LRU cache of that geometry would have for each E. An
+ *   access hits in an E-way set exactly when its distance is below E, and
+ *   a set of E ways evicts on every miss after it has been filled.
+ * 一遍扫描得到所有相联度下的命中、不命中和驱逐次数
+ */
+void stackDistance(char* trace_fn)
+{
+    trace_t trace;
+    trace_rec_t rec;
+    unsigned long long int hits = 0, misses, fills, total;
+    size_t d, e, emax;
+    int i;
+
+    if(s + b > 63 || (unsigned long long)s > 64 - SD_TIME_BITS - 1)
+    {
+        fprintf(stderr, "csim: -d supports at most %d set index bits\n", 64 - SD_TIME_BITS - 1);
+        exit(1);
+    }
+    sd_node_cap = 1024;
+    sd_nodes = malloc(sd_node_cap * sizeof(sd_node_t));
+    memset(&sd_nodes[0], 0, sizeof(sd_node_t));   //0号结点充当空树，大小为0
+    sd_table_mask = 1023;
+    sd_table = calloc(sd_table_mask + 1, sizeof(sd_entry_t));
+    sd_hist_len = 64;
+    sd_hist = calloc(sd_hist_len, sizeof(*sd_hist));
+    sd_set_blocks = calloc(S, sizeof(*sd_set_blocks));
+
+    traceOpen(&trace, trace_fn);
+    while(traceNext(&trace, &rec)) {
+        unsigned int len = rec.len ? rec.len : 1;
+        mem_addr_t a;
+        int pass;
+
+        if(split_lines && crossesBlock(rec.addr, len, b))
+        {
+            sd_splits++;    //跨块访问对每个块各访问一次，M先装入各块再写各块
+            for(pass = rec.op == 'M' ? 2 : 1; pass > 0; pass --)
+                for(a = rec.addr >> b; a <= (rec.addr + len - 1) >> b; a ++)
+                    sdAccess(a << b);
+            continue;
+        }
+        sdAccess(rec.addr);
+        if(rec.op == 'M')
+            sdAccess(rec.addr);
+    }
+    traceClose(&trace);
+
+    /* Largest useful E: beyond it every set holds all of its blocks */
+    for(emax = 1, i = 0; i < S; i ++)
+        if(sd_set_blocks[i] > emax)
+            emax = sd_set_blocks[i];
+    if(E > 0)
+        emax = E;
+    total = sd_time;
+
+    printf("%5s %12s %12s %12s %12s %8s\n", "E", "bytes", "hits", "misses", "evictions", "miss%");
+    for(e = 1, d = 0; e <= emax; e ++)
+    {
+        for(; d < e && d < sd_hist_len; d ++)   //距离小于E的访问都命中
+            hits += sd_hist[d];
+        //E<=64时逐个输出，之后只输出2的幂和最后一行
+        if(e > 64 && (e & (e - 1)) && e != emax)
+            continue;
+        misses = total - hits;
+        for(fills = 0, i = 0; i < S; i ++)
+            fills += sd_set_blocks[i] < e ? sd_set_blocks[i] : e;
+        printf("%5zu %12llu %12llu %12llu %12llu %8.3f\n", e, (unsigned long long)S * e * B,
+               hits, misses, misses - fills, total ? 100.0 * misses / total : 0.0);
+    }
+    printf("cold misses: %llu, distinct blocks: %zu\n", sd_cold, sd_table_used);
+    if(split_lines)
+        printf("line splits: %llu\n", sd_splits);
+
+    free(sd_nodes);
+    free(sd_table);
+    free(sd_hist);
+    free(sd_set_blocks);
+}
+
+/*
+ * printUsage - Print usage info
+ */
+void printUsage(char* argv[])
+{
+    printf("Usage: %s [-hv] [-T <num>] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+    printf("       %s -c <configs> [-j <num>] -t <file>\n", argv[0]);
+    printf("       %s -d -s <num> [-E <num>] -b <num> -t <file>\n", argv[0]);
+    printf("       %s -H <levels> [-i <inclusion>] -t <file>\n", argv[0]);
+    printf("       any of the above with -l, -r <policy>, -w <policy> and -a <policy>\n");
+    printf("       -p <prefetcher> with a single cache or -c\n");
+    printf("Options:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -v         Optional verbose flag.\n");
+    printf("  -s <num>   Number of set index bits (0 for fully associative).\n");
+    printf("  -E <num>   Number of lines per set.\n");
+    printf("  -b <num>   Number of block offset bits.\n");
+    printf("  -t <file>  Trace file.\n");
+    printf("  -T <num>   Time <num> replays of the trace from memory and\n"
+           "             print simulated accesses per second to stderr.\n");
+    printf("  -c <list>  Simulate every s:E:b configuration in <list> in one pass\n"
+           "             and print a table. Configurations are separated by ','\n"
+           "             and each field is a number, a range lo-hi, or a list\n"
+           "             a/b/c; every combination of the fields is simulated.\n");
+    printf("  -j <num>   Split the -c configurations between <num> threads.\n");
+    printf("  -d         Compute LRU stack distances in one pass and print the\n"
+           "             results for every E (up to -E if given).\n");
+    printf("  -r <name>  Replacement policy: lru (default), fifo, random, plru,\n"
+           "             bitplru, srrip, brrip or lfu.\n");
+    printf("  -H <list>  Simulate a hierarchy of caches given as name=s:E:b\n"
+           "             separated by ','. Names are l1d (or l1), l1i, l2, l3...;\n"
+           "             with l1i, instruction fetches are simulated too.\n");
+    printf("  -i <name>  Inclusion of the -H levels: nine (default),\n"
+           "             inclusive or exclusive.\n");
+    printf("  -w <name>  Write hits: back (default, lines turn dirty and are\n"
+           "             written back when evicted) or through. Prints the\n"
+           "             dirty evictions and the bytes written.\n");
+    printf("  -a <name>  Write misses: allocate (default) or noallocate.\n");
+    printf("  -l         Split accesses that cross a block boundary into one\n"
+           "             access per block, and count them.\n");
+    printf("  -p <name>[:<degree>[:<latency>]]\n"
+           "             Prefetcher: next, stride or stream, running <degree>\n"
+           "             blocks or strides ahead (default %d). A prefetch\n"
+           "             arriving later than <latency> accesses (default %d)\n"
+           "             after it is issued is counted as late, and the\n"
+           "             access that waited for it as a miss.\n", pf_degree, pf_latency);
+    printf("\nExamples:\n");
+    printf("  linux>  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  linux>  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  linux>  %s -c 2-8:1/2/4/8:4-6 -j 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -d -s 4 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -r srrip -s 4 -E 8 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -H l1i=4:2:4,l1d=4:2:4,l2=6:4:4 -i inclusive -t traces/trans.trace\n", argv[0]);
+    printf("  linux>  %s -w through -a noallocate -s 4 -E 2 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -l -s 4 -E 2 -b 3 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -p stream:4 -s 4 -E 2 -b 4 -t traces/long.trace\n", argv[0]);
+    exit(0);
+}
+
+/*
+ * main - Main routine 
+ */
+int main(int argc, char* argv[])
+{
+    char c;
+
+    while( (c=getopt(argc,argv,"s:E:b:t:T:c:j:r:H:i:w:a:p:ldvh")) != -1){
+        switch(c){
+        case 's':
+            s = atoi(optarg);
+            break;
+        case 'E':
+            E = atoi(optarg);
+            break;
+        case 'b':
+            b = atoi(optarg);
+            break;
+        case 't':
+            trace_file = optarg;
+            break;
+        case 'T':
+            bench_reps = atoi(optarg);
+            break;
+        case 'c':
+            config_spec = optarg;
+            break;
+        case 'j':
+            num_threads = atoi(optarg);
+            break;
+        case 'd':
+            stack_mode = 1;
+            break;
+        case 'l':
+            split_lines = 1;
+            break;
+        case 'p':
+            for (prefetch = PREFETCH_NEXT; prefetch <= PREFETCH_STREAM; prefetch++) {
+                size_t n = strlen(prefetch_names[prefetch]);
+                if (strncmp(optarg, prefetch_names[prefetch], n) == 0 &&
+                    (optarg[n] == '\0' || optarg[n] == ':'))
+                    break;
+            }
+            if (prefetch > PREFETCH_STREAM ||
+                (strchr(optarg, ':') != NULL &&
+                 sscanf(strchr(optarg, ':'), ":%d:%d", &pf_degree, &pf_latency) < 1) ||
+                pf_degree < 1 || pf_latency < 0) {
+                printf("%s: Bad prefetcher '%s'\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            break;
+        case 'r':
+            for (policy = 0; policy <= POLICY_LFU; policy++)
+                if (strcmp(optarg, policy_names[policy]) == 0)
+                    break;
+            if (policy > POLICY_LFU) {
+                printf("%s: Unknown replacement policy '%s'\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            break;
+        case 'H':
+            hierarchy_spec = optarg;
+            break;
+        case 'i':
+            for (inclusion = 0; inclusion <= INCL_EXCLUSIVE; inclusion++)
+                if (strcmp(optarg, inclusion_names[inclusion]) == 0)
+                    break;
+            if (inclusion > INCL_EXCLUSIVE) {
+                printf("%s: Unknown inclusion policy '%s'\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            break;
+        case 'w':
+            if (strcmp(optarg, "through") == 0)
+                write_policy |= WRITE_THROUGH;
+            else if (strcmp(optarg, "back") != 0) {
+                printf("%s: Unknown write policy '%s'\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            write_stats = 1;
+            break;
+        case 'a':
+            if (strcmp(optarg, "noallocate") == 0)
+                write_policy |= WRITE_NO_ALLOCATE;
+            else if (strcmp(optarg, "allocate") != 0) {
+                printf("%s: Unknown write miss policy '%s'\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            write_stats = 1;
+            break;
+        case 'v':
+            verbosity = 1;
+            break;
+        case 'h':
+            printUsage(argv);
+            exit(0);
+        default:
+            printUsage(argv);
+            exit(1);
+        }
+    }
+
+    /* Simulate a cache hierarchy */
+    if (hierarchy_spec != NULL && trace_file != NULL) {
+        int i;
+
+        if (prefetch != PREFETCH_NONE) {
+            printf("%s: -p is not supported with -H\n", argv[0]);
+            exit(1);
+        }
+        if (inclusion == INCL_EXCLUSIVE && write_policy != 0) {
+            printf("%s: exclusive hierarchies are write-back, write-allocate only\n", argv[0]);
+            exit(1);
+        }
+        parseHierarchy(hierarchy_spec);
+        replayHierarchy(trace_file);
+        for (i = 0; i < hier_count; i++) {
+            printLevelSummary(hier_names[i], hier[i].hit_count, hier[i].miss_count,
+                              hier[i].eviction_count, hier[i].invalidation_count,
+                              hier[i].dirty_count, bytesWritten(&hier[i]));
+            freeCache(&hier[i]);
+        }
+        if (split_lines)
+            printSplitSummary(hier[0].split_count +
+                              (hier_l1i >= 0 ? hier[hier_l1i].split_count : 0));
+        return 0;
+    }
+
+    /* Simulate a list of configurations in one pass */
+    if (config_spec != NULL && trace_file != NULL) {
+        cache_t* caches;
+        int i, n = parseConfigs(config_spec, &caches);
+
+        replayConfigs(trace_file, caches, n);
+        printConfigs(caches, n);
+        for (i = 0; i < n; i++)
+            freeCache(&caches[i]);
+        free(caches);
+        return 0;
+    }
+
+    /* Make sure that all required command line args were specified */
+    if (s < 0 || (E == 0 && !stack_mode) || b == 0 || trace_file == NULL) {
+        printf("%s: Missing required command line argument\n", argv[0]);
+        printUsage(argv);
+        exit(1);
+    }
+
+    /* Compute S, E and B from command line args */
+    S = pow(2, s);
+    B = pow(2, b);
+ 
+    if (stack_mode) {
+        if (policy != POLICY_LRU || prefetch != PREFETCH_NONE || write_policy != 0) {
+            printf("%s: -d only models write-back, write-allocate LRU caches without prefetching\n",
+                   argv[0]);
+            exit(1);
+        }
+        stackDistance(trace_file);
+        return 0;
+    }
+
+    /* Initialize cache */
+    initCache(&cache, s, E, b, policy, write_policy, prefetch);
+
+#ifdef DEBUG_ON
+    printf("DEBUG: S:%u E:%u B:%u trace:%s\n", S, E, B, trace_file);
+    printf("DEBUG: set_index_mask: %llu\n", cache.set_index_mask);
+#endif
+ 
+    if (bench_reps > 0)
+        benchTrace(trace_file);
+    else
+        replayTrace(trace_file);
+
+    /* Free allocated memory */
+    freeCache(&cache);
+
+    /* Output the hit and miss statistics for the autograder */
+    printSummary(cache.hit_count, cache.miss_count, cache.eviction_count);
+    if (write_stats)
+        printWriteSummary(cache.dirty_count, bytesWritten(&cache));
+    if (split_lines)
+        printSplitSummary(cache.split_count);
+    if (prefetch != PREFETCH_NONE)
+        printPrefetchSummary(cache.prefetch_count, cache.useful_count,
+                             cache.late_count, cache.polluting_count,
+                             cache.pf_eviction_count);
+    return 0;
+}
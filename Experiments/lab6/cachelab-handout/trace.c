@@ -0,0 +1,246 @@
+/*
+ * trace.c - Read valgrind and binary memory traces
+ *
+ * The whole file is mapped read-only and parsed in place: there is no
+ * stdio buffering, no per-line copy and no sscanf. See trace.h for the
+ * two formats.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+/*
+ * traceError - Report a malformed trace and exit
+ */
+static void traceError(const trace_t *t, const char *msg)
+{
+    fprintf(stderr, "%s: %s at byte %lu\n", t->name, msg,
+            (unsigned long)(t->pos - t->base));
+    exit(1);
+}
+
+/*
+ * readAll - Read a file that cannot be mapped (a pipe, say) into memory.
+ *   Returns NULL with errno set if a read or an allocation fails.
+ */
+static char *readAll(int fd, size_t *size)
+{
+    size_t cap = 1 << 16, n = 0;
+    char *buf = malloc(cap), *grown;
+    ssize_t got;
+
+    if (buf == NULL)
+        return NULL;
+    while ((got = read(fd, buf + n, cap - n)) != 0) {
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return NULL;
+        }
+        n += got;
+        if (n == cap) {
+            if ((grown = realloc(buf, cap * 2)) == NULL) {
+                free(buf);
+                return NULL;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    *size = n;
+    return buf;
+}
+
+/*
+ * traceOpen - Map the trace file and work out its format
+ */
+void traceOpen(trace_t *t, const char *name)
+{
+    struct stat st;
+    int fd = open(name, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        exit(1);
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->size = st.st_size;
+    if (S_ISREG(st.st_mode) && t->size > 0) {
+        t->base = mmap(NULL, t->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (t->base == MAP_FAILED) {
+            fprintf(stderr, "%s: %s\n", name, strerror(errno));
+            exit(1);
+        }
+        posix_madvise(t->base, t->size, POSIX_MADV_SEQUENTIAL);
+        t->mapped = 1;
+    } else if (!S_ISREG(st.st_mode)) {
+        if ((t->base = readAll(fd, &t->size)) == NULL) {
+            fprintf(stderr, "%s: %s\n", name, strerror(errno));
+            exit(1);
+        }
+    }
+    close(fd);
+
+    t->pos = t->base;
+    t->end = t->base + t->size;
+    if (t->size >= TRACE_MAGIC_LEN && !memcmp(t->base, TRACE_MAGIC, TRACE_MAGIC_LEN)) {
+        t->binary = 1;
+        t->pos += TRACE_MAGIC_LEN;
+    }
+}
+
+/*
+ * traceClose - Release the mapping
+ */
+void traceClose(trace_t *t)
+{
+    if (t->mapped)
+        munmap(t->base, t->size);
+    else
+        free(t->base);
+    t->base = NULL;
+}
+
+/*
+ * hexDigit - Value of a hex digit, or -1
+ */
+static inline int hexDigit(int c)
+{
+    if ((unsigned)(c - '0') < 10)
+        return c - '0';
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 6)
+        return c - 'a' + 10;
+    return -1;
+}
+
+/*
+ * nextText - Parse lines until the next " L|S|M addr,len" line
+ */
+static int nextText(trace_t *t, trace_rec_t *rec)
+{
+    const char *p, *eol;
+    int d;
+
+    while (t->pos < t->end) {
+        p = t->pos;
+        eol = memchr(p, '\n', t->end - p);
+        if (eol == NULL)
+            eol = t->end;
+        t->pos = eol < t->end ? eol + 1 : eol;
+
+        if (eol - p < 4)
+            continue;
+        if (p[1] == 'L' || p[1] == 'S' || p[1] == 'M')
+            rec->op = p[1];
+        else if (p[0] == 'I' && t->ifetch)
+            rec->op = 'I';
+        else
+            continue;       /* instruction fetches unless asked for, and anything else */
+
+        rec->addr = 0;
+        rec->len = 0;
+        for (p += 2; p < eol && *p == ' '; p++)
+            ;
+        for (; p < eol && (d = hexDigit(*p)) >= 0; p++)
+            rec->addr = rec->addr << 4 | d;
+        if (p < eol && *p == ',')
+            for (p++; p < eol && (unsigned)(*p - '0') < 10; p++)
+                rec->len = rec->len * 10 + (*p - '0');
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * getVarint - Decode an unsigned LEB128 value
+ */
+static inline trace_addr_t getVarint(trace_t *t)
+{
+    trace_addr_t v = 0;
+    int shift = 0;
+    unsigned char c;
+
+    do {
+        if (t->pos >= t->end || shift > 63)
+            traceError(t, "truncated record");
+        c = *t->pos++;
+        v |= (trace_addr_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return v;
+}
+
+/*
+ * nextBinary - Decode the next binary record
+ */
+static int nextBinary(trace_t *t, trace_rec_t *rec)
+{
+    static const char ops[] = "LSMI";
+    unsigned char h;
+    trace_addr_t z;
+
+    do {
+        if (t->pos >= t->end)
+            return 0;
+        h = *t->pos++;
+        rec->op = ops[h & 3];
+        rec->len = h >> 2;
+        if (rec->len == TRACE_LEN_INLINE)
+            rec->len = getVarint(t);
+        z = getVarint(t);
+        t->prev += (z >> 1) ^ -(z & 1);     /* undo the zigzag */
+    } while (rec->op == 'I' && !t->ifetch);
+    rec->addr = t->prev;
+    return 1;
+}
+
+/*
+ * traceNext - Read the next data access of the trace
+ */
+int traceNext(trace_t *t, trace_rec_t *rec)
+{
+    return t->binary ? nextBinary(t, rec) : nextText(t, rec);
+}
+
+/*
+ * putVarint - Encode an unsigned LEB128 value
+ */
+static void putVarint(FILE *fp, trace_addr_t v)
+{
+    while (v >= 0x80) {
+        putc((int)(v & 0x7f) | 0x80, fp);
+        v >>= 7;
+    }
+    putc((int)v, fp);
+}
+
+/*
+ * traceWriteRec - Append one access to a binary trace. The caller writes
+ *     TRACE_MAGIC first and starts *prev at 0.
+ */
+void traceWriteRec(FILE *fp, const trace_rec_t *rec, trace_addr_t *prev)
+{
+    trace_addr_t delta = rec->addr - *prev;
+    int op = rec->op == 'L' ? 0 : rec->op == 'S' ? 1 : rec->op == 'M' ? 2 : 3;
+
+    if (rec->len < TRACE_LEN_INLINE) {
+        putc(op | rec->len << 2, fp);
+    } else {
+        putc(op | TRACE_LEN_INLINE << 2, fp);
+        putVarint(fp, rec->len);
+    }
+    /* Zigzag so that small negative steps stay short */
+    putVarint(fp, delta << 1 ^ -(delta >> 63));
+    *prev = rec->addr;
+}
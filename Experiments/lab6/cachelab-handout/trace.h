@@ -0,0 +1,62 @@
+/*
+ * trace.h - Prototypes for reading valgrind and binary memory traces
+ *
+ * A trace is mapped into memory and parsed in place, one data access
+ * at a time. Two formats are recognized:
+ *
+ *   text    valgrind --tool=lackey output, " L|S|M <hex addr>,<len>"
+ *           per line for data and "I  <hex addr>,<len>" for instruction
+ *           fetches
+ *   binary  the TRACE_MAGIC header followed by one record per access:
+ *           a byte holding the op in bits 0-1 (L=0, S=1, M=2, I=3) and the
+ *           length in bits 2-7 (63 means a varint length follows), then
+ *           the zigzag varint of the address minus the previous address
+ */
+
+#ifndef CACHELAB_TRACE_H
+#define CACHELAB_TRACE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define TRACE_MAGIC     "CSIMTRC1"
+#define TRACE_MAGIC_LEN 8
+
+/* Length field of the op byte meaning a varint length follows */
+#define TRACE_LEN_INLINE 63
+
+typedef unsigned long long int trace_addr_t;
+
+/* One data access */
+typedef struct trace_rec {
+    char op;            /* 'L', 'S', 'M', or 'I' for an instruction fetch */
+    unsigned int len;   /* access size in bytes */
+    trace_addr_t addr;  /* address of the first byte */
+} trace_rec_t;
+
+/* An open trace */
+typedef struct trace {
+    const char *name;
+    char *base;         /* start of the mapped file */
+    const char *pos;    /* next byte to parse */
+    const char *end;    /* one past the last byte */
+    size_t size;
+    int binary;         /* nonzero for the binary format */
+    int mapped;         /* base came from mmap rather than malloc */
+    int ifetch;         /* return instruction fetches too; 0 skips them */
+    trace_addr_t prev;  /* previous address, for binary deltas */
+} trace_t;
+
+/* Open a trace file; prints a message and exits on failure */
+void traceOpen(trace_t *t, const char *name);
+
+/* Read the next access into *rec; returns 0 at end of trace */
+int traceNext(trace_t *t, trace_rec_t *rec);
+
+/* Unmap the trace */
+void traceClose(trace_t *t);
+
+/* Append one access to a binary trace; *prev tracks the last address */
+void traceWriteRec(FILE *fp, const trace_rec_t *rec, trace_addr_t *prev);
+
+#endif /* CACHELAB_TRACE_H */
@@ -0,0 +1,80 @@
+/*
+ * tracebin.c - Convert a valgrind memory trace to the compact binary
+ * format that csim also reads (see trace.h), or with -d, convert a trace
+ * in either format back to valgrind text.
+ *
+ * usage: tracebin [-d] <in> <out>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "trace.h"
+
+static void usage(char *prog)
+{
+    fprintf(stderr, "Usage: %s [-hd] <in> <out>\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -h   Print this help message.\n");
+    fprintf(stderr, "  -d   Write valgrind text instead of the binary format.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    trace_t in;
+    trace_rec_t rec;
+    trace_addr_t prev = 0;
+    unsigned long n = 0;
+    long size;
+    int text = 0;
+    FILE *out;
+    int c;
+
+    while ((c = getopt(argc, argv, "dh")) != -1) {
+        switch (c) {
+        case 'd':
+            text = 1;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    traceOpen(&in, argv[optind]);
+    in.ifetch = 1;
+    if ((out = fopen(argv[optind + 1], "wb")) == NULL) {
+        fprintf(stderr, "%s: %s\n", argv[optind + 1], strerror(errno));
+        exit(1);
+    }
+
+    if (!text)
+        fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_LEN, out);
+    while (traceNext(&in, &rec)) {
+        if (text)
+            fprintf(out, "%c%c %llx,%u\n", rec.op == 'I' ? 'I' : ' ',
+                    rec.op == 'I' ? ' ' : rec.op, rec.addr, rec.len);
+        else
+            traceWriteRec(out, &rec, &prev);
+        n++;
+    }
+
+    size = ftell(out);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind + 1], strerror(errno));
+        exit(1);
+    }
+    fprintf(stderr, "%s: %lu accesses, %lu -> %ld bytes\n", argv[optind],
+            n, (unsigned long)in.size, size);
+    traceClose(&in);
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * cxxbench.cc - Run container-heavy C++ workloads against libc malloc
+ *     (through std::allocator) and against the mm package (through
+ *     mm_allocator), and report the time each one takes.
+ *
+ * usage: cxxbench [-n <ops>] [-r <reps>]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "mm_allocator.h"
+
+/* Best of this many runs is reported for each workload */
+#define DEFAULT_REPS 3
+
+/* Number of elements each workload inserts */
+#define DEFAULT_OPS  200000
+
+typedef double (*workload_t)(int ops, bool use_mm);
+
+/*
+ * elapsed - seconds since start
+ */
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * vector_work - grow many vectors by push_back, then drop them
+ */
+template <class Alloc>
+static double vector_work(int ops)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::vector<int, Alloc> > outer;
+    int i;
+
+    outer.resize(64);
+    for (i = 0; i < ops; i++)
+	outer[(i * 7) % 64].push_back(i);
+    for (i = 0; i < 64; i += 2)
+	std::vector<int, Alloc>().swap(outer[i]);
+    for (i = 0; i < ops; i++)
+	outer[(i * 13) % 64].push_back(i);
+    return elapsed(start);
+}
+
+/*
+ * map_work - insert keys into an ordered map, erase half, insert again
+ */
+template <class Alloc>
+static double map_work(int ops)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::map<int, int, std::less<int>, Alloc> m;
+    int i;
+
+    for (i = 0; i < ops; i++)
+	m[(i * 2654435761u) % ops] = i;
+    for (i = 0; i < ops; i += 2)
+	m.erase((i * 2654435761u) % ops);
+    for (i = 0; i < ops / 2; i++)
+	m[ops + i] = i;
+    return elapsed(start);
+}
+
+/*
+ * hash_work - the same pattern on an unordered_map, which also
+ *     reallocates its bucket array as it grows
+ */
+template <class Alloc>
+static double hash_work(int ops)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc> h;
+    int i;
+
+    for (i = 0; i < ops; i++)
+	h[(i * 2654435761u) % ops] = i;
+    for (i = 0; i < ops; i += 2)
+	h.erase((i * 2654435761u) % ops);
+    for (i = 0; i < ops / 2; i++)
+	h[ops + i] = i;
+    return elapsed(start);
+}
+
+static double run_vector(int ops, bool use_mm)
+{
+    return use_mm ? vector_work<mm_allocator<int> >(ops)
+	          : vector_work<std::allocator<int> >(ops);
+}
+
+static double run_map(int ops, bool use_mm)
+{
+    return use_mm ? map_work<mm_allocator<std::pair<const int, int> > >(ops)
+	          : map_work<std::allocator<std::pair<const int, int> > >(ops);
+}
+
+static double run_hash(int ops, bool use_mm)
+{
+    return use_mm ? hash_work<mm_allocator<std::pair<const int, int> > >(ops)
+	          : hash_work<std::allocator<std::pair<const int, int> > >(ops);
+}
+
+/*
+ * best_of - run a workload reps times and return the fastest run. The
+ *     mm heap is reset before each run so every run starts empty.
+ */
+static double best_of(workload_t work, int ops, int reps, bool use_mm)
+{
+    double best = 0, secs;
+    int i;
+
+    for (i = 0; i < reps; i++) {
+	if (use_mm) {
+	    mm_cxx_init();
+	    mem_reset_brk();
+	    if (mm_init() < 0) {
+		fprintf(stderr, "cxxbench: mm_init failed\n");
+		exit(1);
+	    }
+	}
+	secs = work(ops, use_mm);
+	if (i == 0 || secs < best)
+	    best = secs;
+    }
+    return best;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: cxxbench [-h] [-n <ops>] [-r <reps>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <ops>   Elements inserted per workload (default %d).\n", DEFAULT_OPS);
+    fprintf(stderr, "\t-r <reps>  Report the best of <reps> runs (default %d).\n", DEFAULT_REPS);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+	const char *name;
+	workload_t work;
+    } workloads[] = {
+	{"vector", run_vector},
+	{"map", run_map},
+	{"unordered_map", run_hash},
+    };
+    int ops = DEFAULT_OPS, reps = DEFAULT_REPS;
+    double libc_secs, mm_secs;
+    unsigned i;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:r:h")) != EOF) {
+	switch (c) {
+	case 'n':
+	    ops = atoi(optarg);
+	    break;
+	case 'r':
+	    reps = atoi(optarg);
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (ops < 2 || reps < 1) {
+	usage();
+	exit(1);
+    }
+
+    printf("%-14s%10s%10s%8s\n", "workload", "libc", "mm", "mm/libc");
+    for (i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+	libc_secs = best_of(workloads[i].work, ops, reps, false);
+	mm_secs = best_of(workloads[i].work, ops, reps, true);
+	printf("%-14s%10.6f%10.6f%8.2f\n", workloads[i].name,
+	       libc_secs, mm_secs, mm_secs / libc_secs);
+    }
+    return 0;
+}
@@ -7,6 +7,7 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE /* for sched_setaffinity */
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -15,10 +16,15 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "tlbcount.h"
 #include "config.h"
 
 /**********************
@@ -81,14 +87,41 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double probes;   /* avg free blocks examined per mm_malloc (0 for libc) */
+    double tlb;      /* dTLB load misses during the util pass (with -m) */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/* One placement/chunk size configuration tried by the -T auto-tuner */
+typedef struct {
+    int policy;        /* placement policy passed to mm_set_place_policy */
+    size_t threshold;  /* tail placement threshold for MM_PLACE_SPLIT */
+    size_t initchunk;  /* heap size requested by mm_init */
+    size_t chunk;      /* minimum heap extension */
+    int valid;         /* did every trace in the family run correctly? */
+    double util;       /* average space utilization over the family */
+    double thru;       /* throughput over the family in Kops/sec */
+} tune_t;
+
+/* 
+ * xfer_t - A ring of blocks handed from the allocating thread to the
+ * freeing thread in the cross-thread free benchmark (-c)
+ */
+#define XFER_RING 1024  /* blocks in flight between the two threads */
+
+typedef struct {
+    void *slot[XFER_RING];
+    unsigned long head;  /* blocks the producer has put in the ring */
+    unsigned long tail;  /* blocks the consumer has taken out */
+    long n;              /* blocks to hand over in total */
+} xfer_t;
+
 /********************
  * Global variables
  *******************/
 int verbose = 0;        /* global flag for verbose output */
+static int count_tlb = 0; /* count dTLB misses for each trace (set by -m) */
 static int errors = 0;  /* number of errs found when running student malloc */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
@@ -100,6 +133,21 @@ static char *default_tracefiles[] = {
     DEFAULT_TRACEFILES, NULL
 };
 
+/* Operations after which eval_mm_valid snapshots the heap layout (-D) */
+#define MAXSNAPS 64
+static int snap_ops[MAXSNAPS];
+static int num_snaps = 0;
+
+/* Operation after which eval_mm_valid reopens the heap file (-R) */
+static int reattach_op = -1;
+
+/* The placement policies, thresholds and chunk sizes swept by -T */
+static int tune_policies[] = {MM_PLACE_HEAD, MM_PLACE_TAIL, MM_PLACE_SPLIT};
+static size_t tune_thresholds[] = {64, 96, 128, 256};
+static size_t tune_initchunks[] = {1<<6, 1<<12};
+static size_t tune_chunks[] = {1<<10, 1<<12, 1<<14};
+#define NELEMS(a) (sizeof(a) / sizeof((a)[0]))
+
 
 /********************* 
  * Function prototypes 
@@ -124,9 +172,44 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_trace(char *filename, int tracenum, stats_t *stats,
+			  int show_stats);
+
+/* Routine for evaluating the traces in parallel worker processes (-j) */
+static void eval_mm_parallel(char **tracefiles, int num_tracefiles, 
+			     stats_t *stats, int jobs, int show_stats);
+
+/* Routine for measuring the heap profiler's overhead (-s) */
+static void eval_profile_overhead(char **tracefiles, int num_tracefiles, 
+				  stats_t *stats, size_t sample);
+
+/* Routines for the placement auto-tuning mode (-T) */
+static void autotune(char **tracefiles, int num_tracefiles);
+static int tune_configs(tune_t *configs);
+static void tune_family(char **tracefiles, int *members, int num_members,
+			tune_t *config);
+static void print_frontier(char *family, tune_t *configs, int n);
+static void trace_family(char *filename, char *family);
+
+/* Routines for the cross-thread free benchmark (-c) */
+static void eval_remote_free(long n);
+static double xfer_run(long n, int remote);
+static void *xfer_consumer(void *arg);
+
+/* Routines for the heap layout snapshots (-D) */
+static int parse_snap_ops(char *arg);
+static void snapshot_layout(int tracenum, int opnum);
+static void render_layout(FILE *fp, int tracenum, int opnum, char *image);
+
+/* Routines for the heap file reattach check (-R) */
+static int check_reattach(trace_t *trace, int tracenum, int opnum);
+static int layout_free_blocks(FILE *fp, unsigned long *counts);
+static int same_file(FILE *a, FILE *b);
 
 /* Various helper routines */
-static void printresults(int n, stats_t *stats);
+static void printresults(int n, stats_t *stats, int show_probes);
+static void print_mm_stats(int tracenum, char *filename);
+static int parse_policy(char *arg, int *policy, int *limit);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -142,7 +225,6 @@ int main(int argc, char **argv)
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
     trace_t *trace = NULL;     /* stores a single trace file in memory */
-    range_t *ranges = NULL;    /* keeps track of block extents for one trace */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
@@ -150,6 +232,19 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int policy = MM_FIRST_FIT; /* free block search policy (set by -p) */
+    int limit = 0;             /* best-fit probe limit (set by -p best:K) */
+    int tune = 0;        /* If set, sweep placement parameters (-T) */
+    int growth = MM_GROW_FIXED; /* heap growth policy (set by -G) */
+    int bibop = 0;       /* If set, use size-class pages for small blocks (-B) */
+    int show_stats = 0;  /* If set, dump allocator statistics per trace (-S) */
+    int jobs = 1;        /* number of traces evaluated in parallel (-j) */
+    int backing = MEM_BACKING_MALLOC; /* storage for the heap (set by -H) */
+    char *heapfile = NULL;            /* persistent heap file (set by -P) */
+    size_t sample = 0;   /* heap profile sampling interval in bytes (-s) */
+    char *profile = "mm.heap"; /* where to write the heap profile (-o) */
+    FILE *fp;
+    long xfer = 0;       /* blocks handed between threads by -c */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,7 +253,7 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:p:j:H:P:R:s:o:c:D:hvVgalTGBSm")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -181,6 +276,73 @@ int main(int argc, char **argv)
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
+        case 'p': /* Free block search policy used by mm_malloc */
+	    if (parse_policy(optarg, &policy, &limit) == 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'j': /* Evaluate up to this many traces in parallel */
+	    if ((jobs = atoi(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'H': /* Back the simulated heap with huge pages */
+	    if (!strcmp(optarg, "thp"))
+		backing = MEM_BACKING_THP;
+	    else if (!strcmp(optarg, "hugetlb"))
+		backing = MEM_BACKING_HUGETLB;
+	    else {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'P': /* Keep the simulated heap in a persistent file */
+	    heapfile = optarg;
+	    break;
+        case 'R': /* Reopen the heap file after this operation */
+	    if ((reattach_op = atoi(optarg)) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 's': /* Sample the mm heap every <bytes> bytes on average */
+	    if ((sample = strtoul(optarg, NULL, 0)) == 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'o': /* File that receives the heap profile */
+	    profile = optarg;
+	    break;
+        case 'c': /* Benchmark blocks freed by a different thread */
+	    if ((xfer = atol(optarg)) < 1) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'D': /* Snapshot the heap layout after these operations */
+	    if (parse_snap_ops(optarg) == 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+        case 'm': /* Count dTLB misses for each trace */
+	    count_tlb = 1;
+	    break;
+        case 'S': /* Dump mm allocator statistics after each trace */
+	    show_stats = 1;
+	    break;
+        case 'B': /* Serve small blocks from size-class pages */
+	    bibop = 1;
+	    break;
+        case 'G': /* Grow the heap adaptively */
+	    growth = MM_GROW_ADAPTIVE;
+	    break;
+        case 'T': /* Auto-tune placement policy and chunk sizes */
+	    tune = 1;
+	    break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
@@ -238,6 +400,52 @@ int main(int argc, char **argv)
     /* Initialize the timing package */
     init_fsecs();
 
+    /* Set up the heap storage and the dTLB miss counter */
+    mem_set_backing(backing);
+    if (heapfile != NULL) {
+	/* Forked workers would all map the same heap file */
+	if (jobs > 1) {
+	    printf("A heap file needs -j 1, ignoring -j\n");
+	    jobs = 1;
+	}
+	mem_set_file(heapfile);
+    }
+    if (reattach_op >= 0 && (heapfile == NULL || bibop)) {
+	printf("Reattaching needs -P and no -B, ignoring -R\n");
+	reattach_op = -1;
+    }
+
+    /* Snapshot files are named by trace and op only, so one run may write them */
+    if (num_snaps > 0 && (jobs > 1 || tune)) {
+	printf("Heap layout snapshots need -j 1 and no -T, ignoring -D\n");
+	num_snaps = 0;
+    }
+    if (count_tlb && !tlb_count_start()) {
+	printf("dTLB miss counter not available, ignoring -m\n");
+	count_tlb = 0;
+    }
+
+    /*
+     * In auto-tuning mode, sweep the placement configurations over
+     * each trace family instead of computing the performance index
+     */
+    if (tune) {
+	mm_set_search_policy(policy, limit);
+	mm_set_heap_growth(growth);
+	mm_set_bibop(bibop);
+	autotune(tracefiles, num_tracefiles);
+	exit(0);
+    }
+
+    /* The cross-thread free benchmark also replaces the trace runs */
+    if (xfer) {
+	mm_set_search_policy(policy, limit);
+	mm_set_heap_growth(growth);
+	mm_set_bibop(bibop);
+	eval_remote_free(xfer);
+	exit(0);
+    }
+
     /*
      * Optionally run and evaluate the libc malloc package 
      */
@@ -269,7 +477,7 @@ int main(int argc, char **argv)
 	/* Display the libc results in a compact table */
 	if (verbose) {
 	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
+	    printresults(num_tracefiles, libc_stats, 0);
 	}
     }
 
@@ -287,30 +495,39 @@ int main(int argc, char **argv)
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
+    /* Select the allocator policies before any call to mm_init */
+    mm_set_search_policy(policy, limit);
+    mm_set_heap_growth(growth);
+    mm_set_bibop(bibop);
+
+    /* The profile lives in the evaluating process, so it needs -j 1 */
+    if (sample && jobs > 1) {
+	printf("Heap profiling needs -j 1, ignoring -s\n");
+	sample = 0;
+    }
+    mm_set_profile(sample);
+
     /* Evaluate student's mm malloc package using the K-best scheme */
-    for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
-	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
-	    speed_params.trace = trace;
-	    speed_params.ranges = ranges;
-	    if (verbose > 1)
-		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
-	}
-	free_trace(trace);
+    if (jobs > 1) 
+	eval_mm_parallel(tracefiles, num_tracefiles, mm_stats, jobs, show_stats);
+    else
+	for (i=0; i < num_tracefiles; i++)
+	    eval_mm_trace(tracefiles[i], i, &mm_stats[i], show_stats);
+
+    /* Write the samples collected over all traces */
+    if (sample) {
+	if ((fp = fopen(profile, "w")) == NULL || mm_dump_profile(fp) < 0)
+	    unix_error("Could not write the heap profile");
+	fclose(fp);
+	printf("Wrote heap profile to %s (%lu samples dropped)\n", 
+	       profile, mm_profile_dropped());
+	eval_profile_overhead(tracefiles, num_tracefiles, mm_stats, sample);
     }
 
     /* Display the mm results in a compact table */
     if (verbose) {
 	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
+	printresults(num_tracefiles, mm_stats, 1);
 	printf("\n");
     }
 
@@ -653,7 +870,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -678,6 +895,19 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
 
+	/* Snapshots past the end of the trace are taken after the last op */
+	for (j = 0; j < num_snaps; j++)
+	    if (snap_ops[j] == i || 
+		(snap_ops[j] >= trace->num_ops && i == trace->num_ops - 1)) {
+		snapshot_layout(tracenum, i);
+		break;
+	    }
+
+	/* Reopen the heap file and check what mm_init rebuilt from it */
+	if ((reattach_op == i || 
+	     (reattach_op >= trace->num_ops && i == trace->num_ops - 1)) &&
+	    check_reattach(trace, tracenum, i) == 0)
+	    return 0;
     }
 
     /* As far as we know, this is a valid malloc package */
@@ -825,6 +1055,175 @@ static void eval_mm_speed(void *ptr)
         }
 }
 
+/*
+ * eval_mm_trace - Evaluate the mm package on one trace: first for
+ *     correctness, then for space utilization and, if it is correct,
+ *     for speed. The results go into *stats.
+ */
+static void eval_mm_trace(char *filename, int tracenum, stats_t *stats,
+			  int show_stats)
+{
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t speed_params;
+    double tlb;
+
+    trace = read_trace(tracedir, filename);
+    stats->ops = trace->num_ops;
+    if (verbose > 1)
+	printf("Checking mm_malloc for correctness, ");
+    stats->valid = eval_mm_valid(trace, tracenum, &ranges);
+    if (stats->valid) {
+	if (verbose > 1)
+	    printf("efficiency, ");
+	tlb = tlb_count_get();
+	stats->util = eval_mm_util(trace, tracenum, &ranges);
+	if (count_tlb)
+	    stats->tlb = tlb_count_get() - tlb;
+	stats->probes = mm_avg_probes();
+	if (show_stats)
+	    print_mm_stats(tracenum, filename);
+	speed_params.trace = trace;
+	speed_params.ranges = ranges;
+	if (verbose > 1)
+	    printf("and performance.\n");
+	stats->secs = fsecs(eval_mm_speed, &speed_params);
+    }
+    clear_ranges(&ranges);
+    free_trace(trace);
+}
+
+/*
+ * eval_profile_overhead - Time each valid trace with heap profiling off
+ *     and then on, back to back, and print the change in throughput
+ */
+static void eval_profile_overhead(char **tracefiles, int num_tracefiles, 
+				  stats_t *stats, size_t sample)
+{
+    int i;
+    trace_t *trace;
+    speed_t speed_params;
+    double ops = 0, off_secs = 0, on_secs = 0, off, on;
+
+    for (i = 0; i < num_tracefiles; i++) {
+	if (!stats[i].valid)
+	    continue;
+	trace = read_trace(tracedir, tracefiles[i]);
+	speed_params.trace = trace;
+	speed_params.ranges = NULL;
+	mm_set_profile(0);
+	off_secs += fsecs(eval_mm_speed, &speed_params);
+	mm_set_profile(sample);
+	on_secs += fsecs(eval_mm_speed, &speed_params);
+	ops += trace->num_ops;
+	free_trace(trace);
+    }
+    if (ops == 0)
+	return;
+
+    off = ops / 1e3 / off_secs;
+    on = ops / 1e3 / on_secs;
+    printf("Heap profiler overhead: %.0f Kops/sec unsampled, %.0f Kops/sec "
+	   "sampled (%+.1f%%)\n", off, on, 100.0 * (on - off) / off);
+}
+
+/*
+ * eval_mm_parallel - Evaluate the traces in up to jobs forked worker
+ *     processes at once. Each worker gets its own copy of the simulated
+ *     heap, is pinned to its own CPU, and sends its trace's stats and
+ *     error count back to the parent through a pipe. A worker that
+ *     dies without reporting marks its trace as invalid. Throughput
+ *     is only comparable to a serial run if jobs does not exceed the
+ *     number of CPUs.
+ */
+static void eval_mm_parallel(char **tracefiles, int num_tracefiles, 
+			     stats_t *stats, int jobs, int show_stats)
+{
+    int i, slot, next = 0, running = 0;
+    int ncpus;
+    int fds[2];
+    pid_t pid;
+    pid_t *slot_pid;
+    int *slot_fd, *slot_trace;
+    struct {
+	int errors;    /* errors found by the worker */
+	stats_t stats; /* stats for the worker's trace */
+    } result;
+#ifdef __linux__
+    cpu_set_t cpus;
+#endif
+
+    if ((ncpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+	ncpus = 1;
+    if (jobs > num_tracefiles)
+	jobs = num_tracefiles;
+    if ((slot_pid = (pid_t *)calloc(jobs, sizeof(pid_t))) == NULL ||
+	(slot_fd = (int *)calloc(jobs, sizeof(int))) == NULL ||
+	(slot_trace = (int *)calloc(jobs, sizeof(int))) == NULL)
+	unix_error("calloc in eval_mm_parallel failed");
+
+    while (next < num_tracefiles || running > 0) {
+	/* Start the next trace as long as there is a free slot */
+	if (next < num_tracefiles && running < jobs) {
+	    for (slot = 0; slot_pid[slot] != 0; slot++)
+		;
+	    if (pipe(fds) < 0)
+		unix_error("pipe in eval_mm_parallel failed");
+	    fflush(stdout); /* don't let the worker inherit buffered output */
+	    if ((pid = fork()) < 0)
+		unix_error("fork in eval_mm_parallel failed");
+	    if (pid == 0) {
+		close(fds[0]);
+#ifdef __linux__
+		CPU_ZERO(&cpus);
+		CPU_SET(slot % ncpus, &cpus);
+		sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif
+		if (count_tlb)
+		    tlb_count_start(); /* the parent's counter is not inherited */
+		errors = 0;
+		memset(&result, 0, sizeof(result));
+		eval_mm_trace(tracefiles[next], next, &result.stats, show_stats);
+		result.errors = errors;
+		if (write(fds[1], &result, sizeof(result)) != sizeof(result))
+		    unix_error("write in eval_mm_parallel failed");
+		fflush(stdout);
+		exit(0);
+	    }
+	    close(fds[1]);
+	    slot_pid[slot] = pid;
+	    slot_fd[slot] = fds[0];
+	    slot_trace[slot] = next++;
+	    running++;
+	    continue;
+	}
+
+	/* Otherwise wait for a worker to finish and collect its results */
+	if ((pid = wait(NULL)) < 0)
+	    unix_error("wait in eval_mm_parallel failed");
+	for (slot = 0; slot < jobs && slot_pid[slot] != pid; slot++)
+	    ;
+	if (slot == jobs)
+	    continue;
+	i = slot_trace[slot];
+	if (read(slot_fd[slot], &result, sizeof(result)) == sizeof(result)) {
+	    stats[i] = result.stats;
+	    errors += result.errors;
+	}
+	else {
+	    malloc_error(i, 0, "worker process died before reporting");
+	    stats[i].valid = 0;
+	}
+	close(slot_fd[slot]);
+	slot_pid[slot] = 0;
+	running--;
+    }
+
+    free(slot_pid);
+    free(slot_fd);
+    free(slot_trace);
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -910,68 +1309,722 @@ static void eval_libc_speed(void *ptr)
     }
 }
 
+/*****************************************************************
+ * The following routines implement the auto-tuning mode (-T). The
+ * traces are grouped into families by filename, every placement
+ * policy and chunk size configuration is run over each family, and
+ * the configurations that no other one beats in both utilization
+ * and throughput (the Pareto frontier) are reported.
+ ****************************************************************/
+
+/*
+ * autotune - Sweep all configurations over each trace family
+ */
+static void autotune(char **tracefiles, int num_tracefiles)
+{
+    int i, j, k, n;
+    int num_members;
+    int *members;
+    char *done;
+    char family[MAXLINE], other[MAXLINE];
+    tune_t *configs;
+
+    n = tune_configs(NULL);
+    if ((configs = (tune_t *)calloc(n, sizeof(tune_t))) == NULL)
+	unix_error("configs calloc in autotune failed");
+    if ((members = (int *)calloc(num_tracefiles, sizeof(int))) == NULL)
+	unix_error("members calloc in autotune failed");
+    if ((done = (char *)calloc(num_tracefiles, sizeof(char))) == NULL)
+	unix_error("done calloc in autotune failed");
+    tune_configs(configs);
+
+    mem_init();
+
+    for (i = 0; i < num_tracefiles; i++) {
+	if (done[i])
+	    continue;
+
+	/* Collect the traces that belong to the same family as trace i */
+	trace_family(tracefiles[i], family);
+	num_members = 0;
+	for (j = i; j < num_tracefiles; j++) {
+	    trace_family(tracefiles[j], other);
+	    if (!strcmp(family, other)) {
+		members[num_members++] = j;
+		done[j] = 1;
+	    }
+	}
+
+	if (verbose > 1)
+	    printf("\nTuning family %s (%d traces)\n", family, num_members);
+	for (k = 0; k < n; k++)
+	    tune_family(tracefiles, members, num_members, &configs[k]);
+	print_frontier(family, configs, n);
+    }
+
+    free(done);
+    free(members);
+    free(configs);
+}
+
+/*
+ * tune_configs - Fill in the configurations swept by -T (if configs
+ *     is not NULL) and return how many there are.
+ */
+static int tune_configs(tune_t *configs)
+{
+    int p, t, ic, c, nthresh;
+    int n = 0;
+
+    for (p = 0; p < NELEMS(tune_policies); p++) {
+	/* The threshold only matters for the split policy */
+	nthresh = (tune_policies[p] == MM_PLACE_SPLIT) ? 
+	    NELEMS(tune_thresholds) : 1;
+	for (t = 0; t < nthresh; t++)
+	    for (ic = 0; ic < NELEMS(tune_initchunks); ic++)
+		for (c = 0; c < NELEMS(tune_chunks); c++) {
+		    if (configs != NULL) {
+			configs[n].policy = tune_policies[p];
+			configs[n].threshold = tune_thresholds[t];
+			configs[n].initchunk = tune_initchunks[ic];
+			configs[n].chunk = tune_chunks[c];
+		    }
+		    n++;
+		}
+    }
+    return n;
+}
+
+/*
+ * tune_family - Run one configuration over the traces of a family and
+ *     record its average utilization and overall throughput.
+ */
+static void tune_family(char **tracefiles, int *members, int num_members,
+			tune_t *config)
+{
+    int i;
+    double secs = 0, ops = 0, util = 0;
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t speed_params;
+
+    mm_set_place_policy(config->policy, config->threshold);
+    mm_set_chunk_sizes(config->initchunk, config->chunk);
+
+    config->valid = 1;
+    for (i = 0; i < num_members; i++) {
+	trace = read_trace(tracedir, tracefiles[members[i]]);
+	if (!eval_mm_valid(trace, members[i], &ranges)) {
+	    config->valid = 0;
+	    free_trace(trace);
+	    break;
+	}
+	util += eval_mm_util(trace, members[i], &ranges);
+	speed_params.trace = trace;
+	speed_params.ranges = ranges;
+	secs += fsecs(eval_mm_speed, &speed_params);
+	ops += trace->num_ops;
+	free_trace(trace);
+    }
+    clear_ranges(&ranges);
+
+    if (config->valid) {
+	config->util = util / num_members;
+	config->thru = (ops / 1e3) / secs;
+    }
+}
+
+/*
+ * print_frontier - Print the valid configurations of a family that are
+ *     not dominated by any other one, ordered by decreasing utilization.
+ */
+static void print_frontier(char *family, tune_t *configs, int n)
+{
+    int i, j, best;
+    char *onfront;
+    char policy[MAXLINE];
+
+    if ((onfront = (char *)calloc(n, sizeof(char))) == NULL)
+	unix_error("onfront calloc in print_frontier failed");
+
+    for (i = 0; i < n; i++) {
+	if (!configs[i].valid)
+	    continue;
+	onfront[i] = 1;
+	for (j = 0; j < n; j++) {
+	    if (j == i || !configs[j].valid)
+		continue;
+	    if (configs[j].util >= configs[i].util && 
+		configs[j].thru >= configs[i].thru &&
+		(configs[j].util > configs[i].util || 
+		 configs[j].thru > configs[i].thru)) {
+		onfront[i] = 0;
+		break;
+	    }
+	}
+    }
+
+    printf("\nPareto frontier for %s traces:\n", family);
+    printf("%10s%8s%8s%7s%8s\n", "placement", "init", "chunk", "util", "Kops");
+    for (;;) {
+	/* Select the remaining frontier point with the highest util */
+	best = -1;
+	for (i = 0; i < n; i++)
+	    if (onfront[i] && (best < 0 || configs[i].util > configs[best].util))
+		best = i;
+	if (best < 0)
+	    break;
+	onfront[best] = 0;
+
+	if (configs[best].policy == MM_PLACE_HEAD)
+	    strcpy(policy, "head");
+	else if (configs[best].policy == MM_PLACE_TAIL)
+	    strcpy(policy, "tail");
+	else
+	    sprintf(policy, ">=%u", (unsigned)configs[best].threshold);
+	printf("%10s%8u%8u%6.1f%%%8.0f\n", 
+	       policy,
+	       (unsigned)configs[best].initchunk,
+	       (unsigned)configs[best].chunk,
+	       configs[best].util*100.0,
+	       configs[best].thru);
+    }
+    free(onfront);
+}
+
+/*
+ * trace_family - Derive the family of a trace from its filename by
+ *     dropping any directory, the "-bal.rep" suffix and trailing
+ *     digits, so that binary-bal.rep and binary2-bal.rep match.
+ */
+static void trace_family(char *filename, char *family)
+{
+    char *p;
+    int len;
+
+    if ((p = strrchr(filename, '/')) != NULL)
+	filename = p + 1;
+    strcpy(family, filename);
+    if ((p = strstr(family, ".rep")) != NULL)
+	*p = '\0';
+    len = strlen(family);
+    if (len > 4 && !strcmp(family + len - 4, "-bal"))
+	family[len -= 4] = '\0';
+    while (len > 1 && family[len-1] >= '0' && family[len-1] <= '9')
+	family[--len] = '\0';
+}
+
+/*****************************************************************
+ * The following routines implement the cross-thread free benchmark
+ * (-c). One thread allocates blocks and hands them through a ring to
+ * a second thread that frees them, so every mm_free is remote. The
+ * same allocation sequence with the allocating thread freeing the
+ * blocks itself, as they leave the ring, is the baseline.
+ ****************************************************************/
+
+/*
+ * eval_remote_free - Time n blocks freed locally and by another thread
+ */
+static void eval_remote_free(long n)
+{
+    double local_secs, remote_secs;
+    mm_stats_t st;
+
+    mem_init();
+    local_secs = xfer_run(n, 0);
+    remote_secs = xfer_run(n, 1);
+    mm_stats(&st);
+    mem_deinit();
+
+    printf("Cross-thread free benchmark, %ld blocks, %d in flight:\n", 
+	   n, XFER_RING);
+    printf("  same-thread frees   %10.0f Kops/sec\n", 
+	   n / 1e3 / local_secs);
+    printf("  cross-thread frees  %10.0f Kops/sec (%lu drained by the owner)\n", 
+	   n / 1e3 / remote_secs, st.remote_frees);
+}
+
+/*
+ * xfer_run - Allocate n blocks on this thread and free them either here
+ *     (remote == 0) or on a consumer thread; returns the elapsed seconds
+ */
+static double xfer_run(long n, int remote)
+{
+    static xfer_t ring;
+    struct timespec start, end;
+    pthread_t consumer;
+    unsigned long i;
+    void *p;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in xfer_run");
+    ring.head = ring.tail = 0;
+    ring.n = n;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (remote && pthread_create(&consumer, NULL, xfer_consumer, &ring) != 0)
+	unix_error("pthread_create failed in xfer_run");
+
+    for (i = 0; i < n; i++) {
+	/* Wait for a free slot, or free the oldest block ourselves */
+	if (remote)
+	    while (i - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) == XFER_RING)
+		sched_yield();
+	else if (i >= XFER_RING)
+	    mm_free(ring.slot[i % XFER_RING]);
+
+	/* Sizes from 16 to 256 bytes, like small strings and nodes */
+	if ((p = mm_malloc(16 + (i * 37) % 241)) == NULL)
+	    app_error("mm_malloc failed in xfer_run");
+	*(long *)p = i;
+	ring.slot[i % XFER_RING] = p;
+	__atomic_store_n(&ring.head, i + 1, __ATOMIC_RELEASE);
+    }
+
+    if (remote)
+	pthread_join(consumer, NULL);
+    else
+	for (i = (n > XFER_RING) ? n - XFER_RING : 0; i < n; i++)
+	    mm_free(ring.slot[i % XFER_RING]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/*
+ * xfer_consumer - Free every block the producer puts in the ring
+ */
+static void *xfer_consumer(void *arg)
+{
+    xfer_t *ring = (xfer_t *)arg;
+    unsigned long i;
+    void *p;
+
+    for (i = 0; i < ring->n; i++) {
+	while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == i)
+	    sched_yield();
+	p = ring->slot[i % XFER_RING];
+	if (*(long *)p != (long)i)
+	    app_error("xfer_consumer got a corrupted block");
+	__atomic_store_n(&ring->tail, i + 1, __ATOMIC_RELEASE);
+	mm_free(p);
+    }
+    return NULL;
+}
+
+/*****************************************************************
+ * The following routines implement the heap layout snapshots (-D).
+ * After each chosen operation of the validity run, mm_dump_layout
+ * writes the run-length encoded layout of the heap to a file, which
+ * is then rendered as a PPM image and as a text heatmap.
+ ****************************************************************/
+
+/*
+ * parse_snap_ops - Parse a comma separated list of operation numbers.
+ *     Returns 0 if the list is malformed.
+ */
+static int parse_snap_ops(char *arg)
+{
+    char *tok, *end;
+
+    for (tok = strtok(arg, ","); tok != NULL; tok = strtok(NULL, ",")) {
+	if (num_snaps == MAXSNAPS)
+	    return 0;
+	snap_ops[num_snaps] = strtol(tok, &end, 10);
+	if (*end != '\0' || snap_ops[num_snaps] < 0)
+	    return 0;
+	num_snaps++;
+    }
+    return num_snaps > 0;
+}
+
+/*
+ * snapshot_layout - Dump the heap layout after operation opnum of trace
+ *     tracenum to layout-<trace>-<op>.txt and render it
+ */
+static void snapshot_layout(int tracenum, int opnum)
+{
+    char name[MAXLINE], image[MAXLINE];
+    FILE *fp;
+
+    sprintf(name, "layout-%d-%d.txt", tracenum, opnum);
+    sprintf(image, "layout-%d-%d.ppm", tracenum, opnum);
+    if ((fp = fopen(name, "w+")) == NULL)
+	unix_error("Could not create the heap layout file");
+    if (mm_dump_layout(fp) < 0)
+	unix_error("Could not write the heap layout file");
+    rewind(fp);
+    render_layout(fp, tracenum, opnum, image);
+    fclose(fp);
+}
+
+/*
+ * render_layout - Render a layout written by mm_dump_layout. The image
+ *     has LAYOUT_WIDTH pixels per row and colors each pixel by the run
+ *     that covers its first byte: free space dark grey, BiBoP pages
+ *     green, and allocated blocks from blue (small size classes) to red
+ *     (large ones). The text heatmap shows how full each cell of the
+ *     heap is, from ' ' (all free) to '@' (all allocated).
+ */
+#define LAYOUT_WIDTH  256  /* image width in pixels */
+#define LAYOUT_HEIGHT 512  /* most image rows before pixels get coarser */
+#define LAYOUT_PIXEL  64   /* fewest heap bytes per pixel */
+#define HEAT_COLS     64   /* text heatmap columns */
+#define HEAT_ROWS     8    /* text heatmap rows */
+
+static void render_layout(FILE *fp, int tracenum, int opnum, char *image)
+{
+    static const char levels[] = " .:-=+*#%@";
+    unsigned long heapsize, start, blocks, bytes, end, lo, hi, b, per_pixel, 
+	per_cell, used[HEAT_COLS * HEAT_ROWS];
+    unsigned char *pixels, rgb[3];
+    int cls, rows, cell, level, r, col;
+    char line[MAXLINE], kind;
+    void *heap;
+    FILE *out;
+
+    if (fgets(line, MAXLINE, fp) == NULL || 
+	sscanf(line, "# heap %p %lu", &heap, &heapsize) != 2 || heapsize == 0)
+	return;
+
+    per_pixel = (heapsize + LAYOUT_WIDTH * LAYOUT_HEIGHT - 1) / 
+	(LAYOUT_WIDTH * LAYOUT_HEIGHT);
+    if (per_pixel < LAYOUT_PIXEL)
+	per_pixel = LAYOUT_PIXEL;
+    rows = (heapsize + per_pixel * LAYOUT_WIDTH - 1) / (per_pixel * LAYOUT_WIDTH);
+    per_cell = (heapsize + HEAT_COLS * HEAT_ROWS - 1) / (HEAT_COLS * HEAT_ROWS);
+    if ((pixels = (unsigned char *)calloc(rows * LAYOUT_WIDTH, 3)) == NULL)
+	unix_error("pixels calloc in render_layout failed");
+    memset(used, 0, sizeof(used));
+
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (sscanf(line, "%lu %c %d %lu %lu", &start, &kind, &cls, &blocks, &bytes) != 5)
+	    continue;
+	end = start + bytes;
+
+	/* Color the pixels whose first byte lies in the run */
+	if (kind == 'f') {
+	    rgb[0] = rgb[1] = rgb[2] = 40;
+	} else if (kind == 'b') {
+	    rgb[0] = 0; rgb[1] = 170; rgb[2] = 0;
+	} else {
+	    rgb[0] = 255 * cls / (MM_NCLASSES - 1);
+	    rgb[1] = 64;
+	    rgb[2] = 255 - rgb[0];
+	}
+	for (b = (start + per_pixel - 1) / per_pixel; b * per_pixel < end; b++)
+	    memcpy(&pixels[3 * b], rgb, 3);
+
+	/* Add the allocated bytes to the heatmap cells the run overlaps */
+	if (kind == 'f')
+	    continue;
+	for (cell = start / per_cell; cell < HEAT_COLS * HEAT_ROWS && 
+		 cell * per_cell < end; cell++) {
+	    lo = (start > cell * per_cell) ? start : cell * per_cell;
+	    hi = (end < (cell + 1) * per_cell) ? end : (cell + 1) * per_cell;
+	    used[cell] += hi - lo;
+	}
+    }
+
+    /* The image is a binary PPM, which most image viewers can open */
+    if ((out = fopen(image, "wb")) == NULL)
+	unix_error("Could not create the heap layout image");
+    fprintf(out, "P6\n%d %d\n255\n", LAYOUT_WIDTH, rows);
+    fwrite(pixels, 3, rows * LAYOUT_WIDTH, out);
+    fclose(out);
+    free(pixels);
+
+    printf("Heap layout of trace %d after op %d: %lu bytes, %lu per cell (%s)\n",
+	   tracenum, opnum, heapsize, per_cell, image);
+    for (r = 0; r < HEAT_ROWS && r * HEAT_COLS * per_cell < heapsize; r++) {
+	printf("  |");
+	for (col = 0; col < HEAT_COLS; col++) {
+	    cell = r * HEAT_COLS + col;
+	    if (cell * per_cell >= heapsize) {
+		putchar(' ');
+		continue;
+	    }
+	    level = (used[cell] * (sizeof(levels) - 2) + per_cell - 1) / per_cell;
+	    putchar(levels[level]);
+	}
+	printf("|\n");
+    }
+}
+
+/*****************************************************************
+ * The following routines implement the heap file reattach check (-R).
+ * After the chosen operation of the validity run, the heap file is
+ * unmapped and mapped again, and mm_init must take over the heap as
+ * it was: same layout, free lists holding exactly its free blocks,
+ * and every allocated payload intact.
+ ****************************************************************/
+
+/*
+ * check_reattach - Reopen the heap file after operation opnum of trace
+ *     tracenum and check the heap that mm_init rebuilt from it.
+ *     Returns 0 (after reporting the error) if the check fails.
+ */
+static int check_reattach(trace_t *trace, int tracenum, int opnum)
+{
+    unsigned long counts[MM_NCLASSES];
+    FILE *before, *after;
+    mm_stats_t st;
+    char *live, *p;
+    int i, index, cls, ok;
+    size_t j;
+
+    if ((before = tmpfile()) == NULL || (after = tmpfile()) == NULL)
+	unix_error("Could not create the reattach layout files");
+    if (mm_dump_layout(before) < 0)
+	unix_error("Could not write the reattach layout file");
+
+    /* Unmap the heap file, map it again and let mm_init take it over */
+    mem_deinit();
+    mem_init();
+    if (mm_init() < 0) {
+	malloc_error(tracenum, opnum, "mm_init could not reattach to the heap file.");
+	fclose(before);
+	fclose(after);
+	return 0;
+    }
+    if (mm_dump_layout(after) < 0)
+	unix_error("Could not write the reattach layout file");
+
+    /* The blocks themselves must be untouched... */
+    rewind(before);
+    rewind(after);
+    ok = same_file(before, after);
+    fclose(before);
+    if (!ok) {
+	malloc_error(tracenum, opnum, "reattaching changed the heap layout.");
+	fclose(after);
+	return 0;
+    }
+
+    /* ...and each free list must hold exactly the free blocks of its class */
+    rewind(after);
+    ok = layout_free_blocks(after, counts);
+    fclose(after);
+    mm_stats(&st);
+    for (cls = 0; ok && cls < MM_NCLASSES; cls++)
+	ok = (st.free_blocks[cls] == counts[cls]);
+    if (!ok) {
+	malloc_error(tracenum, opnum, "the free lists rebuilt by mm_init "
+		     "do not match the free blocks in the heap.");
+	return 0;
+    }
+
+    /* Every live block still holds the low byte of its index */
+    if ((live = (char *)calloc(trace->num_ids, sizeof(char))) == NULL)
+	unix_error("live calloc in check_reattach failed");
+    for (i = 0; i <= opnum; i++)
+	live[trace->ops[i].index] = (trace->ops[i].type != FREE);
+    for (index = 0, ok = 1; ok && index < trace->num_ids; index++) {
+	p = trace->blocks[index];
+	for (j = 0; live[index] && j < trace->block_sizes[index]; j++)
+	    if ((unsigned char)p[j] != (index & 0xFF)) {
+		ok = 0;
+		break;
+	    }
+    }
+    free(live);
+    if (!ok) {
+	malloc_error(tracenum, opnum, "a payload did not survive "
+		     "reattaching to the heap file.");
+	return 0;
+    }
+
+    if (verbose > 1)
+	printf("Reattached to the heap file after op %d of trace %d\n", 
+	       opnum, tracenum);
+    return 1;
+}
+
+/*
+ * layout_free_blocks - Count the free blocks of each size class in a
+ *     layout written by mm_dump_layout. Returns 0 if it is malformed.
+ */
+static int layout_free_blocks(FILE *fp, unsigned long *counts)
+{
+    unsigned long start, blocks, bytes;
+    char line[MAXLINE], kind;
+    int cls;
+
+    memset(counts, 0, MM_NCLASSES * sizeof(unsigned long));
+    if (fgets(line, MAXLINE, fp) == NULL || strncmp(line, "# heap ", 7) != 0)
+	return 0;
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (sscanf(line, "%lu %c %d %lu %lu", &start, &kind, &cls, &blocks, &bytes) != 5 ||
+	    cls < 0 || cls >= MM_NCLASSES)
+	    return 0;
+	if (kind == 'f')
+	    counts[cls] += blocks;
+    }
+    return 1;
+}
+
+/*
+ * same_file - Return 1 if the two streams hold the same bytes
+ */
+static int same_file(FILE *a, FILE *b)
+{
+    int c;
+
+    while ((c = getc(a)) == getc(b))
+	if (c == EOF)
+	    return 1;
+    return 0;
+}
+
 /*************************************
  * Some miscellaneous helper routines
  ************************************/
 
 
 /*
- * printresults - prints a performance summary for some malloc package
+ * printresults - prints a performance summary for some malloc package.
+ *     If show_probes is set, also prints the average number of free
+ *     blocks mm_malloc examined per request.
  */
-static void printresults(int n, stats_t *stats) 
+static void printresults(int n, stats_t *stats, int show_probes) 
 {
     int i;
     double secs = 0;
     double ops = 0;
     double util = 0;
+    double probes = 0;
+    double tlb = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
+    printf("%5s%7s %5s%8s%10s%6s", 
 	   "trace", " valid", "util", "ops", "secs", "Kops");
+    if (show_probes)
+	printf("%8s", "probes");
+    if (show_probes && count_tlb)
+	printf("%10s", "dTLB");
+    printf("\n");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
+	    if (show_probes)
+		printf("%8.2f", stats[i].probes);
+	    if (show_probes && count_tlb)
+		printf("%10.0f", stats[i].tlb);
+	    printf("\n");
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
+	    probes += stats[i].probes;
+	    tlb += stats[i].tlb;
 	}
 	else {
-	    printf("%2d%10s%6s%8s%10s%6s\n", 
+	    printf("%2d%10s%6s%8s%10s%6s", 
 		   i,
 		   "no",
 		   "-",
 		   "-",
 		   "-",
 		   "-");
+	    if (show_probes)
+		printf("%8s", "-");
+	    if (show_probes && count_tlb)
+		printf("%10s", "-");
+	    printf("\n");
 	}
     }
 
     /* Print the aggregate results for the set of traces */
     if (errors == 0) {
-	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	printf("%12s%5.0f%%%8.0f%10.6f%6.0f", 
 	       "Total       ",
 	       (util/n)*100.0,
 	       ops, 
 	       secs,
 	       (ops/1e3)/secs);
+	if (show_probes)
+	    printf("%8.2f", probes/n);
+	if (show_probes && count_tlb)
+	    printf("%10.0f", tlb);
+	printf("\n");
     }
     else {
-	printf("%12s%6s%8s%10s%6s\n", 
+	printf("%12s%6s%8s%10s%6s", 
 	       "Total       ",
 	       "-", 
 	       "-", 
 	       "-", 
 	       "-");
+	if (show_probes)
+	    printf("%8s", "-");
+	if (show_probes && count_tlb)
+	    printf("%10s", "-");
+	printf("\n");
     }
 
 }
 
+/*
+ * print_mm_stats - Dump the allocator statistics gathered by mm.c
+ *     while running the utilization pass over a trace.
+ */
+static void print_mm_stats(int tracenum, char *filename)
+{
+    int i;
+    mm_stats_t st;
+
+    mm_stats(&st);
+    printf("\nmm stats for trace %d (%s):\n", tracenum, filename);
+    printf("  searches %lu probes %lu splits %lu coalesces %lu\n",
+	   st.searches, st.probes, st.splits, st.coalesces);
+    printf("  extends %lu (%lu bytes) reallocs %lu (%lu copied)\n",
+	   st.extends, st.extend_bytes, st.reallocs, st.realloc_copies);
+    if (st.remote_frees)
+	printf("  remote frees %lu\n", st.remote_frees);
+    if (st.bibop_mallocs || st.bibop_pages)
+	printf("  bibop mallocs %lu frees %lu pages %lu\n",
+	       st.bibop_mallocs, st.bibop_frees, st.bibop_pages);
+    printf("  %5s%10s%10s%10s\n", "class", "mallocs", "frees", "freelist");
+    for (i = 0; i < MM_NCLASSES; i++) {
+	if (st.mallocs[i] == 0 && st.frees[i] == 0 && st.free_blocks[i] == 0)
+	    continue;
+	printf("  %5d%10lu%10lu%10lu\n", 
+	       i, st.mallocs[i], st.frees[i], st.free_blocks[i]);
+    }
+}
+
+/*
+ * parse_policy - Parse the argument of -p: "first", "best[:K]" or
+ *     "good". Returns 0 if the argument is not a known policy.
+ */
+static int parse_policy(char *arg, int *policy, int *limit)
+{
+    if (!strcmp(arg, "first")) {
+	*policy = MM_FIRST_FIT;
+	return 1;
+    }
+    if (!strcmp(arg, "good")) {
+	*policy = MM_GOOD_FIT;
+	return 1;
+    }
+    if (!strncmp(arg, "best", 4)) {
+	*policy = MM_BEST_FIT;
+	*limit = 8; /* default number of candidates per list */
+	if (arg[4] == ':')
+	    *limit = atoi(arg + 5);
+	else if (arg[4] != '\0')
+	    return 0;
+	return (*limit > 0);
+    }
+    return 0;
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -1004,14 +2057,30 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValTGBSm] [-f <file>] [-t <dir>] [-p <policy>] [-j <n>] [-H <pages>] [-P <file>]\n\t\t[-R <op>] [-s <bytes>] [-o <file>] [-c <n>]\n\t\t[-D <ops>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-B         Serve small blocks from size-class pages.\n");
+    fprintf(stderr, "\t-c <n>     Time <n> blocks freed by another thread, then exit.\n");
+    fprintf(stderr, "\t-D <ops>   Snapshot the heap layout after these ops (e.g. 100,2000).\n");
+    fprintf(stderr, "\t           Not with -j <n> > 1 or -T.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
+    fprintf(stderr, "\t-G         Grow the heap adaptively instead of by fixed chunks.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-H <pages> Back the heap with huge pages: thp or hugetlb.\n");
+    fprintf(stderr, "\t-j <n>     Evaluate up to <n> traces in parallel.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-m         Count dTLB misses for each trace.\n");
+    fprintf(stderr, "\t-p <pol>   Search policy: first, best[:K] or good.\n");
+    fprintf(stderr, "\t-o <file>  Write the -s heap profile to <file> (default mm.heap).\n");
+    fprintf(stderr, "\t-P <file>  Keep the heap in <file>, mapped at a fixed address.\n");
+    fprintf(stderr, "\t-R <op>    Reopen the -P heap file after <op> and check it.\n");
+    fprintf(stderr, "\t-s <bytes> Sample a call stack every <bytes> allocated, e.g. 524288,\n");
+    fprintf(stderr, "\t           and report the throughput cost of sampling.\n");
+    fprintf(stderr, "\t-S         Print allocator statistics after each trace.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T         Report the best placement settings per trace family.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
 }
@@ -8,16 +8,64 @@
 #include <assert.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #include "memlib.h"
 #include "config.h"
 
+/* Huge page size used by the THP and hugetlbfs backings */
+#define HUGE_PAGESIZE (2*(1<<20))  /* 2 MB */
+#define HUGE_ROUNDUP(n) (((n) + HUGE_PAGESIZE - 1) & ~((size_t)HUGE_PAGESIZE - 1))
+
+/* 
+ * A file-backed heap is mapped at a fixed address, so that the pointers
+ * stored inside it stay valid across processes. The file starts with a
+ * header page that records the brk, followed by MAX_HEAP heap bytes.
+ */
+#define MEM_FILE_BASE    ((char *)0x60000000)
+#define MEM_FILE_HDRSIZE 4096
+#define MEM_FILE_MAGIC   0x6d6c6962  /* "mlib" */
+
+typedef struct {
+    unsigned int magic;     /* MEM_FILE_MAGIC once the file is set up */
+    unsigned int max_heap;  /* MAX_HEAP of the process that created it */
+    unsigned int brk;       /* offset of the brk from the heap start */
+} mem_file_hdr_t;
+
 /* private variables */
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static int mem_backing = MEM_BACKING_MALLOC; /* where the heap storage came from */
+static char *mem_file_path;  /* heap file for MEM_BACKING_FILE */
+static int mem_file_fd = -1; /* ... and its descriptor while mapped */
+static mem_file_hdr_t *mem_file_hdr; /* header of the mapped heap file */
+
+/* private functions */
+static char *mem_map_huge(int hugetlb);
+static char *mem_map_file(void);
+
+/*
+ * mem_set_backing - choose how the next mem_init obtains its storage
+ */
+void mem_set_backing(int backing)
+{
+    mem_backing = backing;
+}
+
+/*
+ * mem_set_file - keep the heap in the given file (MEM_BACKING_FILE).
+ *    If the file already holds a heap, mem_init reattaches to it and
+ *    the heap keeps its previous contents and size.
+ */
+void mem_set_file(char *path)
+{
+    mem_backing = MEM_BACKING_FILE;
+    mem_file_path = path;
+}
 
 /* 
  * mem_init - initialize the memory system model
@@ -25,9 +73,31 @@ static char *mem_max_addr;   /* largest legal heap address */
 void mem_init(void)
 {
     /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
-	exit(1);
+    switch (mem_backing) {
+    case MEM_BACKING_FILE:
+	if ((mem_start_brk = mem_map_file()) == NULL)
+	    exit(1);
+	mem_max_addr = mem_start_brk + MAX_HEAP;
+	mem_brk = mem_start_brk + mem_file_hdr->brk; /* previous heap, if any */
+	return;
+    case MEM_BACKING_HUGETLB:
+	if ((mem_start_brk = mem_map_huge(1)) != NULL)
+	    break;
+	fprintf(stderr, "mem_init_vm: no hugetlbfs pages, using THP instead\n");
+	mem_backing = MEM_BACKING_THP;
+	/* fall through */
+    case MEM_BACKING_THP:
+	if ((mem_start_brk = mem_map_huge(0)) == NULL) {
+	    fprintf(stderr, "mem_init_vm: mmap error\n");
+	    exit(1);
+	}
+	break;
+    default:
+	if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
+	    fprintf(stderr, "mem_init_vm: malloc error\n");
+	    exit(1);
+	}
+	break;
     }
 
     mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
@@ -39,7 +109,107 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    if (mem_backing == MEM_BACKING_MALLOC)
+	free(mem_start_brk);
+    else if (mem_backing == MEM_BACKING_FILE) {
+	msync(mem_file_hdr, MEM_FILE_HDRSIZE + MAX_HEAP, MS_SYNC);
+	munmap(mem_file_hdr, MEM_FILE_HDRSIZE + MAX_HEAP);
+	close(mem_file_fd);
+	mem_file_hdr = NULL;
+	mem_file_fd = -1;
+    }
+    else
+	munmap(mem_start_brk, HUGE_ROUNDUP(MAX_HEAP));
+}
+
+/*
+ * mem_map_file - map the heap file at MEM_FILE_BASE, creating and
+ *    initializing it if needed. Returns the first heap byte, or NULL
+ *    (after printing why) on failure.
+ */
+static char *mem_map_file(void)
+{
+    size_t size = MEM_FILE_HDRSIZE + MAX_HEAP;
+    struct stat st;
+    char *p;
+    int flags = MAP_SHARED;
+
+    if ((mem_file_fd = open(mem_file_path, O_RDWR | O_CREAT, 0600)) < 0) {
+	fprintf(stderr, "mem_init_vm: can't open %s: %s\n", 
+		mem_file_path, strerror(errno));
+	return NULL;
+    }
+    if (fstat(mem_file_fd, &st) < 0 || 
+	(st.st_size < size && ftruncate(mem_file_fd, size) < 0)) {
+	fprintf(stderr, "mem_init_vm: can't size %s: %s\n", 
+		mem_file_path, strerror(errno));
+	close(mem_file_fd);
+	return NULL;
+    }
+
+#ifdef MAP_FIXED_NOREPLACE
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    p = mmap(MEM_FILE_BASE, size, PROT_READ | PROT_WRITE, flags, 
+	     mem_file_fd, 0);
+    if (p != MEM_FILE_BASE) {
+	fprintf(stderr, "mem_init_vm: can't map %s at %p\n", 
+		mem_file_path, MEM_FILE_BASE);
+	if (p != MAP_FAILED)
+	    munmap(p, size);
+	close(mem_file_fd);
+	return NULL;
+    }
+
+    /* A new (or foreign) file starts out with an empty heap */
+    mem_file_hdr = (mem_file_hdr_t *)p;
+    if (mem_file_hdr->magic != MEM_FILE_MAGIC || 
+	mem_file_hdr->max_heap != MAX_HEAP ||
+	mem_file_hdr->brk > MAX_HEAP) {
+	mem_file_hdr->magic = MEM_FILE_MAGIC;
+	mem_file_hdr->max_heap = MAX_HEAP;
+	mem_file_hdr->brk = 0;
+    }
+    return p + MEM_FILE_HDRSIZE;
+}
+
+/*
+ * mem_map_huge - map a 2 MB aligned region for the heap, either from
+ *    hugetlbfs or as ordinary anonymous memory that the kernel is asked
+ *    to back with transparent huge pages. Returns NULL on failure.
+ */
+static char *mem_map_huge(int hugetlb)
+{
+    size_t size = HUGE_ROUNDUP(MAX_HEAP);
+    char *p, *aligned;
+    size_t lead;
+
+#ifdef MAP_HUGETLB
+    if (hugetlb) {
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	return (p == MAP_FAILED) ? NULL : p;
+    }
+#else
+    if (hugetlb)
+	return NULL;
+#endif
+
+    /* Over-allocate by one huge page so that we can align the start */
+    p = mmap(NULL, size + HUGE_PAGESIZE, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	return NULL;
+    aligned = (char *)HUGE_ROUNDUP((size_t)p);
+    lead = aligned - p;
+    if (lead > 0)
+	munmap(p, lead);
+    munmap(aligned + size, HUGE_PAGESIZE - lead);
+
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return aligned;
 }
 
 /*
@@ -48,6 +218,8 @@ void mem_deinit(void)
 void mem_reset_brk()
 {
     mem_brk = mem_start_brk;
+    if (mem_file_hdr != NULL)
+	mem_file_hdr->brk = 0;
 }
 
 /* 
@@ -65,6 +237,8 @@ void *mem_sbrk(int incr)
 	return (void *)-1;
     }
     mem_brk += incr;
+    if (mem_file_hdr != NULL)
+	mem_file_hdr->brk = mem_brk - mem_start_brk;
     return (void *)old_brk;
 }
 
@@ -99,3 +273,12 @@ size_t mem_pagesize()
 {
     return (size_t)getpagesize();
 }
+
+/*
+ * mem_is_persistent() - returns 1 if the heap is a mapped heap file that
+ *    may hold a heap from an earlier run, 0 otherwise
+ */
+int mem_is_persistent()
+{
+    return mem_file_hdr != NULL;
+}
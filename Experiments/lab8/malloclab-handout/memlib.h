@@ -1,5 +1,13 @@
 #include <unistd.h>
 
+/* How mem_init obtains the storage for the simulated heap */
+#define MEM_BACKING_MALLOC  0  /* plain malloc (the default) */
+#define MEM_BACKING_THP     1  /* 2 MB aligned mmap with MADV_HUGEPAGE */
+#define MEM_BACKING_HUGETLB 2  /* explicit hugetlbfs pages (MAP_HUGETLB) */
+#define MEM_BACKING_FILE    3  /* persistent file mapped at a fixed address */
+
+void mem_set_backing(int backing);
+void mem_set_file(char *path);
 void mem_init(void);               
 void mem_deinit(void);
 void *mem_sbrk(int incr);
@@ -8,4 +16,5 @@ void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
 size_t mem_pagesize(void);
+int mem_is_persistent(void);
 
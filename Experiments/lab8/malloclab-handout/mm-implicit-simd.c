@@ -0,0 +1,389 @@
+/*
+ * mm-implicit-simd.c - Implicit free list allocator with next fit
+ *                      placement whose fit search scans a compact side
+ *                      array instead of hopping from header to header.
+ *
+ * The heap has the same layout as in mm-implicit.c: every block has a
+ * boundary tag header and footer, and prologue and epilogue blocks
+ * bound the list. In addition, two arrays outside the heap describe
+ * the blocks in address order:
+ *
+ *     blk_off[i]   offset of block i's payload from the heap start
+ *     blk_free[i]  size of block i if it is free, 0 if it is allocated
+ *
+ * so a block fits iff blk_free[i] >= asize, and the next fit search is
+ * a linear scan over contiguous 32-bit words that compares 8 (AVX2) or
+ * 4 (SSE2) blocks per instruction, with a scalar loop for the ends and
+ * for builds without either. Splitting and coalescing insert or delete
+ * array entries with memmove, and mm_free finds a block's entry by
+ * binary search on blk_off.
+ *
+ * The side arrays live outside the simulated heap, so they do not show
+ * up in the utilization mdriver reports; the layout is meant as a
+ * baseline for how fast an implicit allocator gets from a cache
+ * friendly search alone.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+/* Team structure */
+team_t team = {
+    "implicit next fit, side array",
+    "Dave OHallaron", "droh",
+    "", ""
+};
+
+/* Basic constants and macros */
+#define WSIZE       4       /* word size (bytes) */
+#define DSIZE       8       /* doubleword size (bytes) */
+#define CHUNKSIZE  (1<<12)  /* initial heap size (bytes) */
+#define OVERHEAD    8       /* overhead of header and footer (bytes) */
+#define MINBLOCK   (DSIZE + OVERHEAD) /* smallest block (bytes) */
+
+/* Most blocks the heap can hold, and so the size of the side arrays */
+#define MAXBLOCKS  (MAX_HEAP / MINBLOCK + 1)
+
+#define MAX(x, y) ((x) > (y)? (x) : (y))
+
+/* Pack a size and allocated bit into a word */
+#define PACK(size, alloc)  ((size) | (alloc))
+
+/* Read and write a word at address p */
+#define GET(p)       (*(unsigned int *)(p))
+#define PUT(p, val)  (*(unsigned int *)(p) = (val))
+
+/* Read the size and allocated fields from address p */
+#define GET_SIZE(p)  (GET(p) & ~0x7)
+#define GET_ALLOC(p) (GET(p) & 0x1)
+
+/* Given block ptr bp, compute address of its header and footer */
+#define HDRP(bp)       ((char *)(bp) - WSIZE)
+#define FTRP(bp)       ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
+
+/* Given block ptr bp, compute address of next block */
+#define NEXT_BLKP(bp)  ((char *)(bp) + GET_SIZE(((char *)(bp) - WSIZE)))
+
+/* Block pointer of side array entry i */
+#define BLKP(i)        ((char *)mem_heap_lo() + blk_off[i])
+
+/* Global variables */
+static char *heap_listp;  /* pointer to the prologue block */
+static unsigned int blk_off[MAXBLOCKS];  /* payload offsets, ascending */
+static unsigned int blk_free[MAXBLOCKS]; /* free block sizes, 0 if allocated */
+static int nblocks;       /* number of entries in the side arrays */
+static int rover;         /* next fit rover (a side array index) */
+
+/* function prototypes for internal helper routines */
+static int extend_heap(size_t words);
+static void place(int i, size_t asize);
+static int find_fit(size_t asize);
+static int scan(size_t asize, int from, int to);
+static int coalesce(int i);
+static int block_index(void *bp);
+static void insert_entry(int i, unsigned int off, unsigned int free_size);
+static void delete_entries(int i, int n);
+
+/*
+ * mm_init - Initialize the memory manager
+ */
+int mm_init(void)
+{
+    /* create the initial empty heap */
+    if ((heap_listp = mem_sbrk(4*WSIZE)) == (void *)-1)
+	return -1;
+    PUT(heap_listp, 0);                        /* alignment padding */
+    PUT(heap_listp+WSIZE, PACK(OVERHEAD, 1));  /* prologue header */
+    PUT(heap_listp+DSIZE, PACK(OVERHEAD, 1));  /* prologue footer */
+    PUT(heap_listp+WSIZE+DSIZE, PACK(0, 1));   /* epilogue header */
+    heap_listp += DSIZE;
+
+    nblocks = 0;
+    rover = 0;
+
+    /* Extend the empty heap with a free block of CHUNKSIZE bytes */
+    if (extend_heap(CHUNKSIZE/WSIZE) < 0)
+	return -1;
+    return 0;
+}
+
+/*
+ * mm_malloc - Allocate a block with at least size bytes of payload
+ */
+void *mm_malloc(size_t size)
+{
+    size_t asize;      /* adjusted block size */
+    size_t extendsize; /* amount to extend heap if no fit */
+    int i;
+
+    /* Ignore spurious requests */
+    if (size <= 0)
+	return NULL;
+
+    /* Adjust block size to include overhead and alignment reqs. */
+    if (size <= DSIZE)
+	asize = MINBLOCK;
+    else
+	asize = DSIZE * ((size + (OVERHEAD) + (DSIZE-1)) / DSIZE);
+
+    /* Search the side array for a fit, else get more memory */
+    if ((i = find_fit(asize)) < 0) {
+	extendsize = MAX(asize,CHUNKSIZE);
+	if ((i = extend_heap(extendsize/WSIZE)) < 0)
+	    return NULL;
+    }
+    place(i, asize);
+    return BLKP(i);
+}
+
+/*
+ * mm_free - Free a block
+ */
+void mm_free(void *bp)
+{
+    size_t size = GET_SIZE(HDRP(bp));
+    int i = block_index(bp);
+
+    PUT(HDRP(bp), PACK(size, 0));
+    PUT(FTRP(bp), PACK(size, 0));
+    blk_free[i] = size;
+    coalesce(i);
+}
+
+/*
+ * mm_realloc - naive implementation of mm_realloc
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+    void *newp;
+    size_t copySize;
+
+    if ((newp = mm_malloc(size)) == NULL) {
+	printf("ERROR: mm_malloc failed in mm_realloc\n");
+	exit(1);
+    }
+    copySize = GET_SIZE(HDRP(ptr)) - OVERHEAD;
+    if (size < copySize)
+      copySize = size;
+    memcpy(newp, ptr, copySize);
+    mm_free(ptr);
+    return newp;
+}
+
+/*
+ * mm_checkheap - Check the heap against the side arrays
+ */
+void mm_checkheap(int verbose)
+{
+    char *bp;
+    int i = 0;
+
+    if ((GET_SIZE(HDRP(heap_listp)) != DSIZE) || !GET_ALLOC(HDRP(heap_listp)))
+	printf("Bad prologue header\n");
+
+    for (bp = NEXT_BLKP(heap_listp); GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp), i++) {
+	if (verbose)
+	    printf("%p: [%d:%c]\n", bp, GET_SIZE(HDRP(bp)),
+		   (GET_ALLOC(HDRP(bp)) ? 'a' : 'f'));
+	if (GET(HDRP(bp)) != GET(FTRP(bp)))
+	    printf("Error: %p header does not match footer\n", bp);
+	if (i >= nblocks || BLKP(i) != bp)
+	    printf("Error: %p has no side array entry %d\n", bp, i);
+	else if (blk_free[i] != (GET_ALLOC(HDRP(bp)) ? 0 : GET_SIZE(HDRP(bp))))
+	    printf("Error: side array entry %d disagrees with %p\n", i, bp);
+    }
+    if (i != nblocks)
+	printf("Error: %d blocks but %d side array entries\n", i, nblocks);
+    if ((GET_SIZE(HDRP(bp)) != 0) || !(GET_ALLOC(HDRP(bp))))
+	printf("Bad epilogue header\n");
+}
+
+/* The remaining routines are internal helper routines */
+
+/*
+ * extend_heap - Extend heap with free block and return its index
+ */
+static int extend_heap(size_t words)
+{
+    char *bp;
+    size_t size;
+
+    /* Allocate an even number of words to maintain alignment */
+    size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
+    if ((bp = mem_sbrk(size)) == (void *)-1)
+	return -1;
+
+    /* Initialize free block header/footer and the epilogue header */
+    PUT(HDRP(bp), PACK(size, 0));         /* free block header */
+    PUT(FTRP(bp), PACK(size, 0));         /* free block footer */
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* new epilogue header */
+
+    /* The new block always goes at the end of the side arrays */
+    insert_entry(nblocks, bp - (char *)mem_heap_lo(), size);
+    return coalesce(nblocks - 1);
+}
+
+/*
+ * place - Place block of asize bytes at start of free block i
+ *         and split if remainder would be at least minimum block size
+ */
+static void place(int i, size_t asize)
+{
+    char *bp = BLKP(i);
+    size_t csize = blk_free[i];
+
+    blk_free[i] = 0;
+    if ((csize - asize) >= MINBLOCK) {
+	PUT(HDRP(bp), PACK(asize, 1));
+	PUT(FTRP(bp), PACK(asize, 1));
+	bp = NEXT_BLKP(bp);
+	PUT(HDRP(bp), PACK(csize-asize, 0));
+	PUT(FTRP(bp), PACK(csize-asize, 0));
+	insert_entry(i + 1, blk_off[i] + asize, csize - asize);
+    }
+    else {
+	PUT(HDRP(bp), PACK(csize, 1));
+	PUT(FTRP(bp), PACK(csize, 1));
+    }
+}
+
+/*
+ * find_fit - Next fit search for a block with asize bytes; returns
+ *            its side array index, or -1 if there is none
+ */
+static int find_fit(size_t asize)
+{
+    int i;
+
+    /* search from the rover to the end, then from the start to the rover */
+    if ((i = scan(asize, rover, nblocks)) < 0)
+	i = scan(asize, 0, rover);
+    if (i >= 0)
+	rover = i;
+    return i;
+}
+
+/*
+ * scan - Return the first index in [from, to) whose free size is at
+ *        least asize, or -1. Sizes stay below 2^31, so the signed
+ *        vector compares are safe.
+ */
+static int scan(size_t asize, int from, int to)
+{
+    int i = from;
+
+#if defined(__AVX2__)
+    __m256i need = _mm256_set1_epi32((int)asize - 1);
+    int mask;
+
+    for (; i + 8 <= to; i += 8) {
+	__m256i v = _mm256_loadu_si256((__m256i *)&blk_free[i]);
+	mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, need)));
+	if (mask)
+	    return i + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    __m128i need = _mm_set1_epi32((int)asize - 1);
+    int mask;
+
+    for (; i + 4 <= to; i += 4) {
+	__m128i v = _mm_loadu_si128((__m128i *)&blk_free[i]);
+	mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, need)));
+	if (mask)
+	    return i + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; i < to; i++)
+	if (blk_free[i] >= asize)
+	    return i;
+    return -1;
+}
+
+/*
+ * coalesce - boundary tag coalescing, using the side array to look at
+ *            the neighbours. Return the index of the coalesced block.
+ */
+static int coalesce(int i)
+{
+    int prev_free = (i > 0) && blk_free[i-1];
+    int next_free = (i + 1 < nblocks) && blk_free[i+1];
+    size_t size = blk_free[i];
+    char *bp;
+
+    if (!prev_free && !next_free)              /* Case 1 */
+	return i;
+
+    if (next_free) {                           /* Case 2 and 4 */
+	size += blk_free[i+1];
+	delete_entries(i + 1, 1);
+    }
+    if (prev_free) {                           /* Case 3 and 4 */
+	size += blk_free[i-1];
+	delete_entries(i, 1);
+	i--;
+    }
+
+    bp = BLKP(i);
+    blk_free[i] = size;
+    PUT(HDRP(bp), PACK(size, 0));
+    PUT(FTRP(bp), PACK(size, 0));
+    return i;
+}
+
+/*
+ * block_index - Binary search blk_off for the entry of block bp
+ */
+static int block_index(void *bp)
+{
+    unsigned int off = (char *)bp - (char *)mem_heap_lo();
+    int lo = 0, hi = nblocks - 1, mid;
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (blk_off[mid] < off)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * insert_entry - Insert a side array entry at index i, keeping the
+ *                rover on the same block
+ */
+static void insert_entry(int i, unsigned int off, unsigned int free_size)
+{
+    memmove(&blk_off[i+1], &blk_off[i], (nblocks - i) * sizeof(blk_off[0]));
+    memmove(&blk_free[i+1], &blk_free[i], (nblocks - i) * sizeof(blk_free[0]));
+    blk_off[i] = off;
+    blk_free[i] = free_size;
+    nblocks++;
+    if (rover > i)
+	rover++;
+}
+
+/*
+ * delete_entries - Delete n side array entries starting at index i;
+ *                  a rover inside them moves to the entry before
+ */
+static void delete_entries(int i, int n)
+{
+    memmove(&blk_off[i], &blk_off[i+n], (nblocks - i - n) * sizeof(blk_off[0]));
+    memmove(&blk_free[i], &blk_free[i+n], (nblocks - i - n) * sizeof(blk_free[0]));
+    nblocks -= n;
+    if (rover >= i + n)
+	rover -= n;
+    else if (rover >= i)
+	rover = (i > 0) ? i - 1 : 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * mm-noext.c - Do-nothing versions of the optional mm.h tuning,
+ *     statistics and profiling hooks, so that allocators that only
+ *     provide mm_init/mm_malloc/mm_free/mm_realloc (such as
+ *     mm-implicit.c) still link with mdriver.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "mm.h"
+
+void mm_set_search_policy(int policy, int limit)
+{
+}
+
+double mm_avg_probes(void)
+{
+    return 0;
+}
+
+void mm_set_place_policy(int policy, size_t threshold)
+{
+}
+
+void mm_set_chunk_sizes(size_t initchunk, size_t chunk)
+{
+}
+
+void mm_set_heap_growth(int policy)
+{
+}
+
+void mm_set_bibop(int enabled)
+{
+}
+
+void mm_stats(mm_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void mm_set_profile(size_t interval)
+{
+}
+
+int mm_dump_profile(FILE *fp)
+{
+    fprintf(fp, "heap profile: 0: 0 [0: 0] @ heap_v2/1\n");
+    return 0;
+}
+
+int mm_dump_layout(FILE *fp)
+{
+    fprintf(fp, "# heap %p 0\n", (void *)0);
+    return 0;
+}
+
+unsigned long mm_profile_dropped(void)
+{
+    return 0;
+}
@@ -14,6 +14,9 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <math.h>
+#include <execinfo.h>
+#include <pthread.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -26,10 +29,20 @@
 #define DSIZE     8
 
 /* 每次扩展堆的块大小（系统调用“费时费力”，一次扩展一大块，然后逐渐利用这一大块） */
+/* 这里是默认值，可以通过mm_set_chunk_sizes修改 */
 #define INITCHUNKSIZE (1<<6)
 #define CHUNKSIZE (1<<12)
 
-#define LISTMAX     16
+/* 自适应扩展时，两次扩展堆之间的malloc次数不超过GROWWINDOW视为突发分配，扩展量翻倍， */
+/* 但不超过当前堆大小的1/GROWFRACTION，这样多扩展出来的部分最多只占堆的一小部分 */
+#define GROWWINDOW 16
+#define GROWFRACTION 8
+
+/* 默认的放置阈值：不小于这个大小的块从free块的尾部切出 */
+#define PLACETHRESHOLD 96
+
+/* 分离空闲表的条数，也是mm_stats按大小分类的类数 */
+#define LISTMAX     MM_NCLASSES
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
@@ -45,6 +58,11 @@
 #define GET_SIZE(p)  (GET(p) & ~0x7)
 #define GET_ALLOC(p) (GET(p) & 0x1)
 
+/* 已分配块头部和脚部的第1、2位：这个块被mm_realloc连续增长的次数（最多3），free时清零 */
+#define GET_HINT(p)                   ((GET(p) >> 1) & 0x3)
+#define PACK_HINT(size, hint, alloc)  ((size) | ((hint) << 1) | (alloc))
+#define HINTMAX 3
+
 #define HDRP(ptr) ((char *)(ptr) - WSIZE)
 #define FTRP(ptr) ((char *)(ptr) + GET_SIZE(HDRP(ptr)) - DSIZE)
 
@@ -57,6 +75,42 @@
 #define PRED(ptr) (*(char **)(ptr))
 #define SUCC(ptr) (*(char **)(SUCC_PTR(ptr)))
 
+/* BiBoP（big bag of pages）模式：小块按大小类各自占用整页，页的开头是页头 */
+/* 页相对于堆的起点mem_heap_lo()按BIBOP_PAGESIZE对齐，每次向堆要BIBOP_RUNPAGES个连续页 */
+#define BIBOP_PAGESIZE  (1<<12)
+#define BIBOP_RUNPAGES  8
+/* 页表能覆盖的最大页数，超出部分的堆不再用作BiBoP页 */
+#define BIBOP_MAXPAGES  8192
+#define BIBOP_CLASSES   8
+
+/* 页头：大小类、使用中的块数、页内free链表、同类页的双向链表、从未用过的块数 */
+#define PAGE_CLASS(pg)  ((char *)(pg))
+#define PAGE_INUSE(pg)  ((char *)(pg) + WSIZE)
+#define PAGE_FREE(pg)   ((char *)(pg) + 2 * WSIZE)
+#define PAGE_NEXT(pg)   ((char *)(pg) + 3 * WSIZE)
+#define PAGE_PREV(pg)   ((char *)(pg) + 4 * WSIZE)
+#define PAGE_BUMP(pg)   ((char *)(pg) + 5 * WSIZE)
+#define PAGE_HDRSIZE    (6 * WSIZE)
+
+#define GET_PTR(p) (*(char **)(p))
+
+/* 堆采样分析：每条调用栈最多记录的帧数，以及调用栈表和存活采样块表的大小（2的幂） */
+#define PROF_MAXDEPTH  32
+#define PROF_MAXSTACKS 1024
+#define PROF_MAXLIVE   4096
+/* 存活采样块表按块地址散列 */
+#define PROF_HASH(ptr) (((unsigned int)(ptr) * 2654435761u) & (PROF_MAXLIVE - 1))
+
+/* 最后一条分离空闲表（大于等于2^(LISTMAX-1)字节的块）组织成嵌在free块里的treap， */
+/* 按（大小，地址）排序，segregated_free_lists[TREELIST]存根节点 */
+#define TREELIST (LISTMAX - 1)
+#define LEFT_PTR(ptr)  ((char *)(ptr))
+#define RIGHT_PTR(ptr) ((char *)(ptr) + WSIZE)
+#define LEFT(ptr)  (*(char **)(LEFT_PTR(ptr)))
+#define RIGHT(ptr) (*(char **)(RIGHT_PTR(ptr)))
+/* 节点的优先级由地址散列得到，不需要额外存储，期望树高为O(log n) */
+#define TREE_PRIO(ptr) ((unsigned int)(ptr) * 2654435761u)
+
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
  * provide your team information in the following struct.
@@ -77,28 +131,164 @@ team_t team = {
 
 void *segregated_free_lists[LISTMAX];
 
+/* BiBoP模式下每个大小类的块大小 */
+static const size_t bibop_sizes[BIBOP_CLASSES] = {8, 16, 24, 32, 48, 64, 96, 128};
+/* 是否启用BiBoP模式，由mm_set_bibop设置 */
+static int bibop_enabled = 0;
+/* 每个大小类中还有空位的页，以及完全空闲、可以分给任何大小类的页 */
+static char *bibop_partial[BIBOP_CLASSES];
+static char *bibop_empty_pages;
+/* 页表：记录堆中每一页的大小类+1，0表示这一页不是BiBoP页 */
+static unsigned char bibop_page_map[BIBOP_MAXPAGES];
+
+/* 空闲块搜索策略，由mm_set_search_policy设置，mm_init之后生效 */
+static int search_policy = MM_FIRST_FIT;
+static int search_limit = 0;
+/* 本次mm_init以来的统计，只有堆的所有者线程会修改，直接用普通的静态计数器 */
+static mm_stats_t stats;
+
+/* 调用mm_init的线程拥有整个堆，只有它能分配和直接释放块 */
+static pthread_t heap_owner;
+/* 其他线程释放的块先无锁地压入这个栈（链接放在块的payload里），所有者下次分配时取走 */
+static void *remote_frees;
+
+/* 放置策略和阈值，由mm_set_place_policy设置 */
+static int place_policy = MM_PLACE_SPLIT;
+static size_t place_threshold = PLACETHRESHOLD;
+/* 初始和每次扩展堆的大小，由mm_set_chunk_sizes设置 */
+static size_t initchunksize = INITCHUNKSIZE;
+static size_t chunksize = CHUNKSIZE;
+/* 扩展堆的策略，由mm_set_heap_growth设置 */
+static int grow_policy = MM_GROW_FIXED;
+/* 下一次扩展堆时的扩展量，以及上一次扩展堆时已经进行的malloc次数 */
+static size_t grow_size = CHUNKSIZE;
+static unsigned long last_grow_at = 0;
+
+/* 采样分析：平均每分配prof_interval字节采样一次，0表示不采样，由mm_set_profile设置 */
+static size_t prof_interval = 0;
+/* 距离下一次采样还需要分配的字节数，每次采样后按几何分布重新抽取 */
+static long prof_countdown;
+static unsigned long long prof_seed;
+/* 每条调用栈上采样到的分配：累计的和还没有free的 */
+typedef struct {
+    int depth;
+    void *pc[PROF_MAXDEPTH];
+    unsigned long alloc_objs, alloc_bytes;
+    unsigned long inuse_objs, inuse_bytes;
+} prof_stack_t;
+static prof_stack_t prof_stacks[PROF_MAXSTACKS];
+static int prof_nstacks;
+/* 还没有free的采样块，线性探测的散列表，ptr为NULL的槽是空的 */
+typedef struct {
+    void *ptr;
+    size_t size;
+    int stack;
+} prof_live_t;
+static prof_live_t prof_live_blocks[PROF_MAXLIVE];
+static int prof_live;
+/* 表满而没有记录下来的采样数 */
+static unsigned long prof_dropped;
+
+/* 返回size大小的块所属的分离空闲表 */
+static int list_index(size_t size);
+/* 按当前搜索策略在分离空闲表中寻找能容纳size的free块 */
+static void *find_fit(size_t size);
+/* 没有合适的free块时，根据最近的分配情况决定扩展多少，返回可以容纳size的free块 */
+static void *grow_heap(size_t size);
 /* 扩展推 */
 static void *extend_heap(size_t size);
 /* 合并相邻的Free block */
 static void *coalesce(void *ptr);
 /* 在prt所指向的free block块中allocate size大小的块，如果剩下的空间大于2*DWSIZE，则将其分离后放入Free list */
 static void *place(void *ptr, size_t size);
+/* 按当前放置策略判断size大小的块是否应该从free块的尾部切出 */
+static int place_at_tail(size_t size);
 /* 将ptr所指向的free block插入到分离空闲表中 */
 static void insert_node(void *ptr, size_t size);
 /* 将ptr所指向的块从分离空闲表中删除 */
 static void delete_node(void *ptr);
+/* 在大块treap中插入、删除节点，返回新的子树根 */
+static char *tree_insert(char *root, char *node);
+static char *tree_remove(char *root, char *node);
+/* 合并两棵treap，left中的节点都比right中的小 */
+static char *tree_merge(char *left, char *right);
+/* 在大块treap中寻找能容纳size的最小块 */
+static char *tree_best_fit(size_t size);
+/* 统计treap中的节点数 */
+static unsigned long tree_count(char *root);
+/* 从BiBoP页中分配size大小的块，size太大或者没有页可用时返回NULL */
+static void *bibop_malloc(size_t size);
+/* ptr在BiBoP页中时返回它所在页的页头，否则返回NULL */
+static char *bibop_page(void *ptr);
+/* 把ptr释放回它所在的BiBoP页 */
+static void bibop_free(char *page, void *ptr);
+/* 向堆申请一组对齐的新页，放入空页链表 */
+static int bibop_grow(void);
+
+/* 所有者线程释放一个块 */
+static void free_block(void *ptr);
+/* 其他线程释放块：压入remote_frees */
+static void remote_free(void *ptr);
+/* 所有者取走remote_frees中的全部块并逐个释放 */
+static void drain_remote_frees(void);
+/* 非所有者线程调用了只有所有者能调用的函数：报错并终止 */
+static void not_owner(const char *func);
+/* 接管文件映射的持久堆中已有的堆，重建分离空闲表 */
+static int mm_reattach(void);
+/* 记录一次采样：保存ptr的调用栈，并把ptr加入存活采样块表 */
+static void prof_record(void *ptr, size_t size);
+/* ptr是存活的采样块时，把它从存活采样块表中删除 */
+static void prof_forget(void *ptr);
+/* 按几何分布抽取下一次采样前要分配的字节数 */
+static long prof_next_interval(void);
 
 int mm_init(void)
 {
     int listnumber;
     char *heap; 
 
+    /* 重置统计 */
+    memset(&stats, 0, sizeof(stats));
+    grow_size = chunksize;
+    last_grow_at = 0;
+
+    /* 堆重置后，还没取走的远程释放块也一起作废 */
+    heap_owner = pthread_self();
+    __atomic_store_n(&remote_frees, NULL, __ATOMIC_RELAXED);
+
+    /* 堆重置后原来的采样块都不存在了，只保留累计的采样 */
+    if (prof_live > 0)
+    {
+        memset(prof_live_blocks, 0, sizeof(prof_live_blocks));
+        prof_live = 0;
+    }
+    for (listnumber = 0; listnumber < prof_nstacks; listnumber++)
+    {
+        prof_stacks[listnumber].inuse_objs = 0;
+        prof_stacks[listnumber].inuse_bytes = 0;
+    }
+
     /* 初始化分离空闲链表 */
     for (listnumber = 0; listnumber < LISTMAX; listnumber++)
     {
         segregated_free_lists[listnumber] = NULL;
     }
 
+    /* 初始化BiBoP的页链表和页表 */
+    if (bibop_enabled)
+    {
+        for (listnumber = 0; listnumber < BIBOP_CLASSES; listnumber++)
+        {
+            bibop_partial[listnumber] = NULL;
+        }
+        bibop_empty_pages = NULL;
+        memset(bibop_page_map, 0, sizeof(bibop_page_map));
+    }
+
+    /* 只有文件映射的持久堆才接管原有的堆，其他堆总是重新初始化 */
+    if (mem_is_persistent() && mem_heapsize() > 0)
+        return mm_reattach();
+
     /* 初始化堆 */
     if ((long)(heap = mem_sbrk(4 * WSIZE)) == -1)
         return -1;
@@ -110,7 +300,46 @@ int mm_init(void)
     PUT(heap + (3 * WSIZE), PACK(0, 1));
 
     /* 扩展堆 */
-    if (extend_heap(INITCHUNKSIZE) == NULL)
+    if (extend_heap(initchunksize) == NULL)
+        return -1;
+
+    return 0;
+}
+
+/*
+ * mm_reattach - 接管一个已有的堆
+ *  先检查起始和结束结构，再顺序遍历所有块，把空闲块重新插入分离空闲链表
+ *  链表里存的是绝对地址，所以直接重建而不是沿用旧的链表
+ *  BiBoP的页表在堆外，无法恢复，因此BiBoP模式下不能接管
+ */
+static int mm_reattach(void)
+{
+    char *lo = mem_heap_lo();
+    char *end = (char *)mem_heap_hi() + 1;
+    char *ptr;
+    size_t size;
+
+    if (bibop_enabled || mem_heapsize() < 4 * WSIZE)
+        return -1;
+
+    /* 检查起始块和结尾块 */
+    if (GET(lo) != 0 || GET(lo + WSIZE) != PACK(DSIZE, 1) ||
+        GET(lo + (2 * WSIZE)) != PACK(DSIZE, 1) || GET(end - WSIZE) != PACK(0, 1))
+        return -1;
+
+    for (ptr = lo + (4 * WSIZE); (size = GET_SIZE(HDRP(ptr))) > 0; ptr = NEXT_BLKP(ptr))
+    {
+        /* 块必须对齐、不越界，且头部和脚部一致 */
+        if (size < 2 * DSIZE || (size & (DSIZE - 1)) || ptr + size > end ||
+            GET(HDRP(ptr)) != GET(FTRP(ptr)))
+            return -1;
+
+        if (!GET_ALLOC(HDRP(ptr)))
+            insert_node(ptr, size);
+    }
+
+    /* 遍历必须正好停在结尾块 */
+    if (ptr != end)
         return -1;
 
     return 0;
@@ -118,8 +347,29 @@ int mm_init(void)
 
 void *mm_malloc(size_t size)
 {
+    void *ptr;
+    size_t request = size;
+
     if (size == 0)
         return NULL;
+
+    /* 只有所有者线程能分配，否则会和所有者同时改动空闲链表 */
+    if (!pthread_equal(pthread_self(), heap_owner))
+        not_owner("mm_malloc");
+
+    /* 先回收其他线程释放的块 */
+    if (__atomic_load_n(&remote_frees, __ATOMIC_RELAXED) != NULL)
+        drain_remote_frees();
+
+    /* BiBoP模式下小块直接从对应大小类的页中分配 */
+    if (bibop_enabled && (ptr = bibop_malloc(size)) != NULL)
+    {
+        stats.bibop_mallocs++;
+        if (prof_interval && (prof_countdown -= (long)request) <= 0)
+            prof_record(ptr, request);
+        return ptr;
+    }
+
     /* 内存对齐 */
     if (size <= DSIZE)
     {
@@ -130,47 +380,250 @@ void *mm_malloc(size_t size)
         size = ALIGN(size + DSIZE);
     }
 
+    stats.mallocs[list_index(size)]++;
+    ptr = find_fit(size);
 
-    int listnumber = 0;
-    size_t searchsize = size;
-    void *ptr = NULL;
+    /* 没有找到合适的free块，扩展堆 */
+    if (ptr == NULL)
+    {
+        if ((ptr = grow_heap(size)) == NULL)
+            return NULL;
+    }
+
+    /* 在free块中allocate size大小的块 */
+    ptr = place(ptr, size);
+
+    /* 不采样时只多一次判断 */
+    if (prof_interval && (prof_countdown -= (long)request) <= 0)
+        prof_record(ptr, request);
+
+    return ptr;
+}
+
+/*
+ * mm_set_search_policy - 设置空闲块搜索策略，limit只对best-fit有效
+ */
+void mm_set_search_policy(int policy, int limit)
+{
+    search_policy = policy;
+    search_limit = (limit > 0) ? limit : 1;
+}
+
+/*
+ * mm_avg_probes - 自上次mm_init以来每次malloc平均检查的free块个数
+ */
+double mm_avg_probes(void)
+{
+    if (stats.searches == 0)
+        return 0.0;
+    return (double)stats.probes / (double)stats.searches;
+}
 
-    while (listnumber < LISTMAX)
+/*
+ * mm_stats - 取得自上次mm_init以来的统计，各分离空闲表的当前长度在这里现数
+ */
+void mm_stats(mm_stats_t *out)
+{
+    int listnumber;
+    void *ptr;
+
+    *out = stats;
+    for (listnumber = 0; listnumber < TREELIST; listnumber++)
     {
-        /* 寻找对应链 */
-        if (((searchsize <= 1) && (segregated_free_lists[listnumber] != NULL)))
+        out->free_blocks[listnumber] = 0;
+        for (ptr = segregated_free_lists[listnumber]; ptr != NULL; ptr = PRED(ptr))
+            out->free_blocks[listnumber]++;
+    }
+    out->free_blocks[TREELIST] = tree_count(segregated_free_lists[TREELIST]);
+}
+
+/*
+ * mm_set_place_policy - 设置切分free块时的放置策略，threshold只对MM_PLACE_SPLIT有效
+ */
+void mm_set_place_policy(int policy, size_t threshold)
+{
+    place_policy = policy;
+    place_threshold = threshold;
+}
+
+/*
+ * mm_set_chunk_sizes - 设置mm_init时和之后每次扩展堆的最小大小
+ */
+void mm_set_chunk_sizes(size_t initchunk, size_t chunk)
+{
+    initchunksize = initchunk;
+    chunksize = chunk;
+}
+
+/*
+ * mm_set_heap_growth - 设置扩展堆的策略：固定按chunksize扩展，或根据最近的分配频率自适应扩展
+ */
+void mm_set_heap_growth(int policy)
+{
+    grow_policy = policy;
+}
+
+/*
+ * mm_set_bibop - 设置是否启用BiBoP模式，在mm_init之前调用
+ */
+void mm_set_bibop(int enabled)
+{
+    bibop_enabled = enabled;
+}
+
+void mm_set_profile(size_t interval)
+{
+    prof_interval = interval;
+    prof_seed = 0x9e3779b97f4a7c15ull;
+    prof_nstacks = 0;
+    prof_live = 0;
+    prof_dropped = 0;
+    memset(prof_live_blocks, 0, sizeof(prof_live_blocks));
+    if (interval)
+        prof_countdown = prof_next_interval();
+}
+
+/*
+ * mm_dump_profile - 以pprof能读的堆分析格式（heap_v2）输出采样结果
+ *  每行是一条调用栈上还没有free的和累计的采样块数、字节数，
+ *  pprof按采样间隔把采样数据还原成估计的总量
+ */
+int mm_dump_profile(FILE *fp)
+{
+    unsigned long inuse_objs = 0, inuse_bytes = 0, alloc_objs = 0, alloc_bytes = 0;
+    prof_stack_t *st;
+    FILE *maps;
+    char line[256];
+    int i, j;
+
+    for (i = 0; i < prof_nstacks; i++)
+    {
+        inuse_objs += prof_stacks[i].inuse_objs;
+        inuse_bytes += prof_stacks[i].inuse_bytes;
+        alloc_objs += prof_stacks[i].alloc_objs;
+        alloc_bytes += prof_stacks[i].alloc_bytes;
+    }
+    fprintf(fp, "heap profile: %lu: %lu [%lu: %lu] @ heap_v2/%lu\n",
+            inuse_objs, inuse_bytes, alloc_objs, alloc_bytes, (unsigned long)prof_interval);
+
+    for (i = 0; i < prof_nstacks; i++)
+    {
+        st = &prof_stacks[i];
+        fprintf(fp, "%lu: %lu [%lu: %lu] @", st->inuse_objs, st->inuse_bytes,
+                st->alloc_objs, st->alloc_bytes);
+        for (j = 0; j < st->depth; j++)
+            fprintf(fp, " %p", st->pc[j]);
+        fprintf(fp, "\n");
+    }
+
+    /* pprof需要进程的内存映射来把地址对应到符号 */
+    fprintf(fp, "\nMAPPED_LIBRARIES:\n");
+    if ((maps = fopen("/proc/self/maps", "r")) != NULL)
+    {
+        while (fgets(line, sizeof(line), maps) != NULL)
+            fputs(line, fp);
+        fclose(maps);
+    }
+
+    return ferror(fp) ? -1 : 0;
+}
+
+/*
+ * mm_dump_layout - 从堆头到堆尾顺序遍历所有块，把地址连续、类型和大小类都相同的块合并成一段输出
+ *  每段一行：起始偏移 类型(a已分配/f空闲/bBiBoP页) 大小类 块数 字节数
+ */
+int mm_dump_layout(FILE *fp)
+{
+    char *lo = mem_heap_lo();
+    char *ptr, *run_start = NULL;
+    char kind, run_kind = 0;
+    int listnumber, run_class = 0;
+    unsigned long run_blocks = 0, run_bytes = 0;
+    size_t size;
+
+    fprintf(fp, "# heap %p %lu\n", lo, (unsigned long)mem_heapsize());
+    if (mem_heapsize() < 4 * WSIZE)
+        return ferror(fp) ? -1 : 0;
+
+    /* 跳过起始块，遍历到结尾块为止；最后多走一轮把最后一段输出 */
+    for (ptr = lo + (4 * WSIZE);; ptr = NEXT_BLKP(ptr))
+    {
+        size = GET_SIZE(HDRP(ptr));
+        if (size > 0)
         {
-            ptr = segregated_free_lists[listnumber];
-            /* 在该链寻找大小合适的free块 */
-            while ((ptr != NULL) && ((size > GET_SIZE(HDRP(ptr)))))
+            if (!GET_ALLOC(HDRP(ptr)))
+                kind = 'f';
+            /* BiBoP的一组页是页对齐的固定大小的已分配块，其中还没用到的页不在页表里 */
+            else if (bibop_enabled && size == BIBOP_RUNPAGES * BIBOP_PAGESIZE + DSIZE &&
+                     (ptr - lo) % BIBOP_PAGESIZE == 0)
+                kind = 'b';
+            else
+                kind = 'a';
+            listnumber = list_index(size);
+            if (run_blocks > 0 && kind == run_kind && listnumber == run_class)
             {
-                ptr = PRED(ptr);
+                run_blocks++;
+                run_bytes += size;
+                continue;
             }
-            /* 找到对应的free块 */
-            if (ptr != NULL)
-                break;
         }
 
-        searchsize >>= 1;
-        listnumber++;
-    }
+        if (run_blocks > 0)
+            fprintf(fp, "%lu %c %d %lu %lu\n", (unsigned long)(HDRP(run_start) - lo),
+                    run_kind, run_class, run_blocks, run_bytes);
+        if (size == 0)
+            break;
 
-    /* 没有找到合适的free块，扩展堆 */
-    if (ptr == NULL)
-    {
-        if ((ptr = extend_heap(MAX(size, CHUNKSIZE))) == NULL)
-            return NULL;
+        run_start = ptr;
+        run_kind = kind;
+        run_class = listnumber;
+        run_blocks = 1;
+        run_bytes = size;
     }
 
-    /* 在free块中allocate size大小的块 */
-    ptr = place(ptr, size);
+    return ferror(fp) ? -1 : 0;
+}
 
-    return ptr;
+size_t mm_usable_size(void *ptr)
+{
+    char *page;
+
+    if (bibop_enabled && (page = bibop_page(ptr)) != NULL)
+        return bibop_sizes[GET(PAGE_CLASS(page))];
+    return GET_SIZE(HDRP(ptr)) - DSIZE;
+}
+
+unsigned long mm_profile_dropped(void)
+{
+    return prof_dropped;
 }
 
 void mm_free(void *ptr)
 {
-    size_t size = GET_SIZE(HDRP(ptr));
+    if (pthread_equal(pthread_self(), heap_owner))
+        free_block(ptr);
+    else
+        remote_free(ptr);
+}
+
+static void free_block(void *ptr)
+{
+    size_t size;
+    char *page;
+
+    if (prof_live > 0)
+        prof_forget(ptr);
+
+    /* BiBoP页中的块不读块头，直接通过页地址找到页头 */
+    if (bibop_enabled && (page = bibop_page(ptr)) != NULL)
+    {
+        stats.bibop_frees++;
+        bibop_free(page, ptr);
+        return;
+    }
+
+    size = GET_SIZE(HDRP(ptr));
+    stats.frees[list_index(size)]++;
 
     PUT(HDRP(ptr), PACK(size, 0));
     PUT(FTRP(ptr), PACK(size, 0));
@@ -183,11 +636,41 @@ void mm_free(void *ptr)
 
 void *mm_realloc(void *ptr, size_t size)
 {
-    void *new_block = ptr;
-    int remainder;
+    void *new_block;
+    char *next;
+    char *page;
+    size_t old_size, avail, want;
+    int hint, at_tail;
 
+    if (ptr == NULL)
+        return mm_malloc(size);
     if (size == 0)
+    {
+        mm_free(ptr);
         return NULL;
+    }
+
+    if (!pthread_equal(pthread_self(), heap_owner))
+        not_owner("mm_realloc");
+
+    stats.reallocs++;
+
+    if (__atomic_load_n(&remote_frees, __ATOMIC_RELAXED) != NULL)
+        drain_remote_frees();
+
+    /* BiBoP页中的块：大小类放得下就原地返回，否则换一个块 */
+    if (bibop_enabled && (page = bibop_page(ptr)) != NULL)
+    {
+        old_size = bibop_sizes[GET(PAGE_CLASS(page))];
+        if (size <= old_size)
+            return ptr;
+        if ((new_block = mm_malloc(size)) == NULL)
+            return NULL;
+        memcpy(new_block, ptr, old_size);
+        /* 经free_block释放，采样记录和BiBoP的free计数才会跟着更新 */
+        free_block(ptr);
+        return new_block;
+    }
 
     /* 内存对齐 */
     if (size <= DSIZE)
@@ -199,38 +682,130 @@ void *mm_realloc(void *ptr, size_t size)
         size = ALIGN(size + DSIZE);
     }
 
-    /* 如果size小于原来块的大小，直接返回原来的块 */
-    if ((remainder = GET_SIZE(HDRP(ptr)) - size) >= 0)
+    /* 如果size不大于原来块的大小，直接返回原来的块 */
+    old_size = GET_SIZE(HDRP(ptr));
+    if (size <= old_size)
     {
         return ptr;
     }
-    /* 否则先检查地址连续下一个块是否为free块或者该块是堆的结束块，因为我们要尽可能利用相邻的free块，以此减小“external fragmentation” */
-    else if (!GET_ALLOC(HDRP(NEXT_BLKP(ptr))) || !GET_SIZE(HDRP(NEXT_BLKP(ptr))))
+
+    /* 同一个块被连续增长时（如vector、字符串不断追加），需要搬移时按几何级数多分配一些， */
+    /* 增长次数越多多分配得越多，这样之后的增长不用再复制；原地增长没有复制的代价，不多分配 */
+    hint = GET_HINT(HDRP(ptr));
+    want = size;
+    if (hint > 0)
+    {
+        want = MAX(size, ALIGN(old_size + (old_size >> (HINTMAX + 1 - hint))));
+    }
+    hint = MIN(hint + 1, HINTMAX);
+
+    /* 尽可能利用地址连续的下一个free块，以此减小“external fragmentation” */
+    next = NEXT_BLKP(ptr);
+    avail = old_size + (GET_ALLOC(HDRP(next)) ? 0 : GET_SIZE(HDRP(next)));
+    /* 下一个块是结尾块，或者是紧挨着结尾块的free块时，扩展堆的部分会接在这个块后面 */
+    at_tail = GET_SIZE(HDRP(next)) == 0 ||
+              (!GET_ALLOC(HDRP(next)) && GET_SIZE(HDRP(NEXT_BLKP(next))) == 0);
+
+    /* 扩展同样按当前的扩展策略，由grow_heap决定扩展多少 */
+    if (avail < size && at_tail)
     {
-        /* 即使加上后面连续地址上的free块空间也不够，需要扩展块 */
-        if ((remainder = GET_SIZE(HDRP(ptr)) + GET_SIZE(HDRP(NEXT_BLKP(ptr))) - size) < 0)
+        if (grow_heap(size - old_size) == NULL)
+            return NULL;
+        /* 扩展出来的free块已经和原来的下一个free块合并 */
+        next = NEXT_BLKP(ptr);
+        avail = old_size + GET_SIZE(HDRP(next));
+    }
+
+    /* 原地增长：整个吸收后面的free块 */
+    if (avail >= size)
+    {
+        if (avail > old_size)
         {
-            if (extend_heap(MAX(-remainder, CHUNKSIZE)) == NULL)
-                return NULL;
-            remainder += MAX(-remainder, CHUNKSIZE);
+            delete_node(next);
         }
-
-        /* 删除刚刚利用的free块并设置新块的头尾 */
-        delete_node(NEXT_BLKP(ptr));
-        PUT(HDRP(ptr), PACK(size + remainder, 1));
-        PUT(FTRP(ptr), PACK(size + remainder, 1));
+        PUT(HDRP(ptr), PACK_HINT(avail, hint, 1));
+        PUT(FTRP(ptr), PACK_HINT(avail, hint, 1));
+        return ptr;
     }
-    /* 没有可以利用的连续free块，而且size大于原来的块，这时只能申请新的不连续的free块、复制原块内容、释放原块 */
-    else
+
+    /* 没有可以利用的连续free块，只能申请新的不连续的free块、复制原块内容、释放原块 */
+    stats.realloc_copies++;
+    if ((new_block = mm_malloc(want - DSIZE)) == NULL)
+        return NULL;
+    memcpy(new_block, ptr, old_size - DSIZE);
+    mm_free(ptr);
+    /* 新块可能来自BiBoP页，那里的块没有头部 */
+    if (!bibop_enabled || bibop_page(new_block) == NULL)
     {
-        new_block = mm_malloc(size);
-        memcpy(new_block, ptr, GET_SIZE(HDRP(ptr)));
-        mm_free(ptr);
+        PUT(HDRP(new_block), PACK_HINT(GET_SIZE(HDRP(new_block)), hint, 1));
+        PUT(FTRP(new_block), PACK_HINT(GET_SIZE(HDRP(new_block)), hint, 1));
     }
 
     return new_block;
 }
 
+/*
+ * remote_free - 多个线程可以同时压栈，只有所有者会取走整个栈，所以没有ABA问题
+ */
+static void remote_free(void *ptr)
+{
+    void *head = __atomic_load_n(&remote_frees, __ATOMIC_RELAXED);
+
+    do
+    {
+        *(void **)ptr = head;
+    } while (!__atomic_compare_exchange_n(&remote_frees, &head, ptr, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void drain_remote_frees(void)
+{
+    void *ptr = __atomic_exchange_n(&remote_frees, NULL, __ATOMIC_ACQUIRE);
+    void *next;
+
+    for (; ptr != NULL; ptr = next)
+    {
+        next = *(void **)ptr;
+        stats.remote_frees++;
+        free_block(ptr);
+    }
+}
+
+static void not_owner(const char *func)
+{
+    fprintf(stderr, "%s: called on a thread that does not own the heap\n", func);
+    abort();
+}
+
+static void *grow_heap(size_t size)
+{
+    /* 堆结尾块的脚部，它前面就是结尾的0/1块 */
+    char *tail_ftr = (char *)mem_heap_hi() + 1 - DSIZE;
+    size_t tail_free = GET_ALLOC(tail_ftr) ? 0 : GET_SIZE(tail_ftr);
+    size_t need;
+
+    /* 堆尾部的free块会和新扩展的部分合并，只需要再扩展不足的部分 */
+    /* best:K的搜索有探测上限，可能跳过了本来就够大的尾部free块，直接用它 */
+    if (tail_free >= size)
+        return tail_ftr + DSIZE - tail_free;
+    need = MAX(size - tail_free, 2 * DSIZE);
+
+    /* 距离上一次扩展堆很近，说明正处在突发分配中，按几何级数增大扩展量；否则恢复默认扩展量 */
+    /* last_grow_at为0说明这是mm_init之后第一次扩展，不算突发 */
+    if ((grow_policy == MM_GROW_ADAPTIVE) && (last_grow_at != 0) &&
+        (stats.searches - last_grow_at <= GROWWINDOW))
+        grow_size = MIN(grow_size * 2, MAX(chunksize, mem_heapsize() / GROWFRACTION));
+    else
+        grow_size = chunksize;
+    last_grow_at = stats.searches;
+
+    /* 比扩展量还大的请求多半是一次性的大块，只扩展恰好够用的大小 */
+    if (size > grow_size)
+        return extend_heap(need);
+
+    return extend_heap(MAX(need, grow_size));
+}
+
 static void *extend_heap(size_t size)
 {
     void *ptr;
@@ -239,6 +814,8 @@ static void *extend_heap(size_t size)
     /* 系统调用“sbrk”扩展堆 */
     if ((ptr = mem_sbrk(size)) == (void *)-1)
         return NULL;
+    stats.extends++;
+    stats.extend_bytes += size;
 
     /* 设置刚刚扩展的free块的头和尾 */
     PUT(HDRP(ptr), PACK(size, 0));
@@ -251,18 +828,214 @@ static void *extend_heap(size_t size)
     return coalesce(ptr);
 }
 
-static void insert_node(void *ptr, size_t size)
+static void *bibop_malloc(size_t size)
+{
+    int cls = 0;
+    char *page;
+    char *ptr;
+
+    /* 找到能容纳size的最小大小类 */
+    while ((cls < BIBOP_CLASSES) && (bibop_sizes[cls] < size))
+        cls++;
+    if (cls == BIBOP_CLASSES)
+        return NULL;
+
+    /* 该类没有还有空位的页时，拿一个空页 */
+    if ((page = bibop_partial[cls]) == NULL)
+    {
+        if ((bibop_empty_pages == NULL) && !bibop_grow())
+            return NULL;
+        page = bibop_empty_pages;
+        bibop_empty_pages = GET_PTR(PAGE_NEXT(page));
+
+        PUT(PAGE_CLASS(page), cls);
+        PUT(PAGE_INUSE(page), 0);
+        SET_PTR(PAGE_FREE(page), NULL);
+        SET_PTR(PAGE_NEXT(page), NULL);
+        SET_PTR(PAGE_PREV(page), NULL);
+        PUT(PAGE_BUMP(page), (BIBOP_PAGESIZE - PAGE_HDRSIZE) / bibop_sizes[cls]);
+        bibop_page_map[(page - (char *)mem_heap_lo()) / BIBOP_PAGESIZE] = cls + 1;
+        bibop_partial[cls] = page;
+    }
+
+    /* 先用页内free链表中的块，没有的话再用从未用过的块 */
+    if ((ptr = GET_PTR(PAGE_FREE(page))) != NULL)
+    {
+        SET_PTR(PAGE_FREE(page), GET_PTR(ptr));
+    }
+    else
+    {
+        PUT(PAGE_BUMP(page), GET(PAGE_BUMP(page)) - 1);
+        ptr = page + PAGE_HDRSIZE + GET(PAGE_BUMP(page)) * bibop_sizes[cls];
+    }
+    PUT(PAGE_INUSE(page), GET(PAGE_INUSE(page)) + 1);
+
+    /* 页满了就从该类的链表中摘下，它总是链表的第一页 */
+    if ((GET_PTR(PAGE_FREE(page)) == NULL) && (GET(PAGE_BUMP(page)) == 0))
+    {
+        bibop_partial[cls] = GET_PTR(PAGE_NEXT(page));
+        if (bibop_partial[cls] != NULL)
+            SET_PTR(PAGE_PREV(bibop_partial[cls]), NULL);
+    }
+
+    return ptr;
+}
+
+static char *bibop_page(void *ptr)
+{
+    size_t index = ((char *)ptr - (char *)mem_heap_lo()) / BIBOP_PAGESIZE;
+
+    if ((index >= BIBOP_MAXPAGES) || (bibop_page_map[index] == 0))
+        return NULL;
+    return (char *)mem_heap_lo() + index * BIBOP_PAGESIZE;
+}
+
+static void bibop_free(char *page, void *ptr)
+{
+    int cls = GET(PAGE_CLASS(page));
+    int was_full = (GET_PTR(PAGE_FREE(page)) == NULL) && (GET(PAGE_BUMP(page)) == 0);
+    char *next;
+    char *prev;
+
+    SET_PTR(ptr, GET_PTR(PAGE_FREE(page)));
+    SET_PTR(PAGE_FREE(page), ptr);
+    PUT(PAGE_INUSE(page), GET(PAGE_INUSE(page)) - 1);
+
+    /* 页全空了，从该类的链表中摘下，还给空页链表，之后可以给任何大小类用 */
+    if (GET(PAGE_INUSE(page)) == 0)
+    {
+        if (!was_full)
+        {
+            next = GET_PTR(PAGE_NEXT(page));
+            prev = GET_PTR(PAGE_PREV(page));
+            if (prev != NULL)
+                SET_PTR(PAGE_NEXT(prev), next);
+            else
+                bibop_partial[cls] = next;
+            if (next != NULL)
+                SET_PTR(PAGE_PREV(next), prev);
+        }
+        bibop_page_map[(page - (char *)mem_heap_lo()) / BIBOP_PAGESIZE] = 0;
+        SET_PTR(PAGE_NEXT(page), bibop_empty_pages);
+        bibop_empty_pages = page;
+    }
+    /* 原来满的页又有了空位，放回该类链表的开头 */
+    else if (was_full)
+    {
+        SET_PTR(PAGE_PREV(page), NULL);
+        SET_PTR(PAGE_NEXT(page), bibop_partial[cls]);
+        if (bibop_partial[cls] != NULL)
+            SET_PTR(PAGE_PREV(bibop_partial[cls]), page);
+        bibop_partial[cls] = page;
+    }
+}
+
+static int bibop_grow(void)
+{
+    char *lo = (char *)mem_heap_lo();
+    char *brk = (char *)mem_heap_hi() + 1;
+    size_t pad = (BIBOP_PAGESIZE - (brk - lo) % BIBOP_PAGESIZE) % BIBOP_PAGESIZE;
+    size_t size = BIBOP_RUNPAGES * BIBOP_PAGESIZE + DSIZE;
+    char *run;
+    int i;
+
+    /* 先用一个free块把堆尾填到页边界，这个free块之后可以正常分配 */
+    if ((pad != 0) && (pad < 2 * DSIZE))
+        pad += BIBOP_PAGESIZE;
+    if ((brk + pad - lo) / BIBOP_PAGESIZE + BIBOP_RUNPAGES > BIBOP_MAXPAGES)
+        return 0;
+    if ((pad != 0) && (extend_heap(pad) == NULL))
+        return 0;
+
+    /* 这一组页在边界标记堆里是一个已分配块，它的块头在上一页的最后一个字，块尾在最后一页之后 */
+    if ((run = mem_sbrk(size)) == (void *)-1)
+        return 0;
+    stats.extends++;
+    stats.extend_bytes += size;
+    stats.bibop_pages += BIBOP_RUNPAGES;
+    PUT(HDRP(run), PACK(size, 1));
+    PUT(FTRP(run), PACK(size, 1));
+    PUT(HDRP(NEXT_BLKP(run)), PACK(0, 1));
+
+    for (i = BIBOP_RUNPAGES - 1; i >= 0; i--)
+    {
+        SET_PTR(PAGE_NEXT(run + i * BIBOP_PAGESIZE), bibop_empty_pages);
+        bibop_empty_pages = run + i * BIBOP_PAGESIZE;
+    }
+    return 1;
+}
+
+static int list_index(size_t size)
 {
     int listnumber = 0;
-    void *search_ptr = NULL;
-    void *insert_ptr = NULL;
 
-    /* 通过块的大小找到对应的链 */
+    /* 与insert_node的分类方式一致：第n条链放大小在[2^n, 2^(n+1))之间的块，最后一条链放所有更大的块 */
     while ((listnumber < LISTMAX - 1) && (size > 1))
     {
         size >>= 1;
         listnumber++;
     }
+    return listnumber;
+}
+
+static void *find_fit(size_t size)
+{
+    int listnumber;
+    int probes;
+    void *ptr;
+
+    stats.searches++;
+    listnumber = list_index(size);
+
+    /* good-fit：先只看本链和相邻上一条链的表头，上一条链中的块一定放得下 */
+    if (search_policy == MM_GOOD_FIT)
+    {
+        if ((ptr = segregated_free_lists[listnumber]) != NULL)
+        {
+            stats.probes++;
+            if (size <= GET_SIZE(HDRP(ptr)))
+                return ptr;
+        }
+        if ((listnumber < TREELIST) && (ptr = segregated_free_lists[listnumber + 1]) != NULL)
+        {
+            stats.probes++;
+            return ptr;
+        }
+    }
+
+    /* insert_node按大小有序插入，链中的块由小到大排列，所以第一个放得下的块就是该链中已检查过的块里最合适的 */
+    /* best-fit依赖这一顺序：每条链中最多检查search_limit个块，避免在一串稍小的块上线性扫描 */
+    for (; listnumber < TREELIST; listnumber++)
+    {
+        probes = 0;
+        ptr = segregated_free_lists[listnumber];
+        while (ptr != NULL)
+        {
+            stats.probes++;
+            if (size <= GET_SIZE(HDRP(ptr)))
+                return ptr;
+            if ((search_policy == MM_BEST_FIT) && (++probes >= search_limit))
+                break;
+            ptr = PRED(ptr);
+        }
+    }
+
+    /* 最后在大块treap中找最合适的块 */
+    return tree_best_fit(size);
+}
+
+static void insert_node(void *ptr, size_t size)
+{
+    int listnumber = list_index(size);
+    void *search_ptr = NULL;
+    void *insert_ptr = NULL;
+
+    /* 大块插入treap */
+    if (listnumber == TREELIST)
+    {
+        segregated_free_lists[TREELIST] = tree_insert(segregated_free_lists[TREELIST], ptr);
+        return;
+    }
 
     /* 找到对应的链后，在该链中继续寻找对应的插入位置，以此保持链中块由小到大的特性 */
     search_ptr = segregated_free_lists[listnumber];
@@ -311,14 +1084,13 @@ static void insert_node(void *ptr, size_t size)
 
 static void delete_node(void *ptr)
 {
-    int listnumber = 0;
-    size_t size = GET_SIZE(HDRP(ptr));
+    int listnumber = list_index(GET_SIZE(HDRP(ptr)));
 
-    /* 通过块的大小找到对应的链 */
-    while ((listnumber < LISTMAX - 1) && (size > 1))
+    /* 大块从treap中删除 */
+    if (listnumber == TREELIST)
     {
-        size >>= 1;
-        listnumber++;
+        segregated_free_lists[TREELIST] = tree_remove(segregated_free_lists[TREELIST], ptr);
+        return;
     }
 
     /* 根据这个块的情况分四种可能性 */
@@ -352,6 +1124,108 @@ static void delete_node(void *ptr)
     }
 }
 
+/* treap中节点的顺序：先比大小，大小相同再比地址 */
+#define TREE_LESS(a, b) ((GET_SIZE(HDRP(a)) < GET_SIZE(HDRP(b))) || \
+                         ((GET_SIZE(HDRP(a)) == GET_SIZE(HDRP(b))) && ((char *)(a) < (char *)(b))))
+
+static char *tree_insert(char *root, char *node)
+{
+    char *child;
+
+    if (root == NULL)
+    {
+        SET_PTR(LEFT_PTR(node), NULL);
+        SET_PTR(RIGHT_PTR(node), NULL);
+        return node;
+    }
+
+    /* 按二叉搜索树插入，再把优先级更高的子节点旋转上来 */
+    if (TREE_LESS(node, root))
+    {
+        child = tree_insert(LEFT(root), node);
+        SET_PTR(LEFT_PTR(root), child);
+        if (TREE_PRIO(child) > TREE_PRIO(root))
+        {
+            /* 右旋 */
+            SET_PTR(LEFT_PTR(root), RIGHT(child));
+            SET_PTR(RIGHT_PTR(child), root);
+            return child;
+        }
+    }
+    else
+    {
+        child = tree_insert(RIGHT(root), node);
+        SET_PTR(RIGHT_PTR(root), child);
+        if (TREE_PRIO(child) > TREE_PRIO(root))
+        {
+            /* 左旋 */
+            SET_PTR(RIGHT_PTR(root), LEFT(child));
+            SET_PTR(LEFT_PTR(child), root);
+            return child;
+        }
+    }
+    return root;
+}
+
+static char *tree_remove(char *root, char *node)
+{
+    /* 找到节点后用它的两棵子树合并的结果代替它 */
+    if (root == node)
+        return tree_merge(LEFT(root), RIGHT(root));
+
+    if (TREE_LESS(node, root))
+        SET_PTR(LEFT_PTR(root), tree_remove(LEFT(root), node));
+    else
+        SET_PTR(RIGHT_PTR(root), tree_remove(RIGHT(root), node));
+    return root;
+}
+
+static char *tree_merge(char *left, char *right)
+{
+    if (left == NULL)
+        return right;
+    if (right == NULL)
+        return left;
+
+    /* 优先级高的做根 */
+    if (TREE_PRIO(left) > TREE_PRIO(right))
+    {
+        SET_PTR(RIGHT_PTR(left), tree_merge(RIGHT(left), right));
+        return left;
+    }
+    SET_PTR(LEFT_PTR(right), tree_merge(left, LEFT(right)));
+    return right;
+}
+
+static char *tree_best_fit(size_t size)
+{
+    char *node = segregated_free_lists[TREELIST];
+    char *best = NULL;
+
+    /* 放得下就记下来再往左找更小的，放不下就往右找 */
+    while (node != NULL)
+    {
+        stats.probes++;
+        if (size <= GET_SIZE(HDRP(node)))
+        {
+            best = node;
+            node = LEFT(node);
+        }
+        else
+        {
+            node = RIGHT(node);
+        }
+    }
+    return best;
+}
+
+static unsigned long tree_count(char *root)
+{
+    if (root == NULL)
+        return 0;
+    return 1 + tree_count(LEFT(root)) + tree_count(RIGHT(root));
+}
+
 static void *coalesce(void *ptr)
 {
     _Bool is_prev_alloc = GET_ALLOC(HDRP(PREV_BLKP(ptr)));
@@ -395,6 +1269,8 @@ static void *coalesce(void *ptr)
         ptr = PREV_BLKP(ptr);
     }
 
+    stats.coalesces++;
+
     /* 将合并好的free块加入到空闲链接表中 */
     insert_node(ptr, size);
 
@@ -416,8 +1292,9 @@ static void *place(void *ptr, size_t size)
         PUT(FTRP(ptr), PACK(ptr_size, 1));
     }
 
-    else if (size >= 96)
+    else if (place_at_tail(size))
     {
+        stats.splits++;
         PUT(HDRP(ptr), PACK(remainder, 0));
         PUT(FTRP(ptr), PACK(remainder, 0));
         PUT(HDRP(NEXT_BLKP(ptr)), PACK(size, 1));
@@ -428,6 +1305,7 @@ static void *place(void *ptr, size_t size)
 
     else
     {
+        stats.splits++;
         PUT(HDRP(ptr), PACK(size, 1));
         PUT(FTRP(ptr), PACK(size, 1));
         PUT(HDRP(NEXT_BLKP(ptr)), PACK(remainder, 0));
@@ -435,4 +1313,118 @@ static void *place(void *ptr, size_t size)
         insert_node(NEXT_BLKP(ptr), remainder);
     }
     return ptr;
-}
\ No newline at end of file
+}
+
+static int place_at_tail(size_t size)
+{
+    switch (place_policy)
+    {
+    case MM_PLACE_HEAD:
+        return 0;
+    case MM_PLACE_TAIL:
+        return 1;
+    default:
+        /* 大块放在尾部，小块放在头部，使大小相近的块聚在一起，减少碎片 */
+        return size >= place_threshold;
+    }
+}
+static long prof_next_interval(void)
+{
+    double u;
+
+    /* xorshift64*，取高53位作为(0, 1]上的均匀分布 */
+    prof_seed ^= prof_seed >> 12;
+    prof_seed ^= prof_seed << 25;
+    prof_seed ^= prof_seed >> 27;
+    u = ((prof_seed * 2685821657736338717ull) >> 11) * (1.0 / 9007199254740992.0);
+    u = 1.0 - u;
+
+    /* 指数分布的间隔使每个字节被采样的概率都是1/prof_interval */
+    return (long)(-log(u) * prof_interval) + 1;
+}
+
+static void __attribute__((noinline)) prof_record(void *ptr, size_t size)
+{
+    void *pc[PROF_MAXDEPTH + 1];
+    prof_stack_t *st;
+    int depth, i;
+    unsigned int h;
+
+    prof_countdown = prof_next_interval();
+
+    /* 存活采样块表最多填一半，保证探测序列短 */
+    if (prof_live >= PROF_MAXLIVE / 2)
+    {
+        prof_dropped++;
+        return;
+    }
+
+    /* 第0帧是prof_record自己 */
+    depth = backtrace(pc, PROF_MAXDEPTH + 1) - 1;
+    if (depth < 0)
+        depth = 0;
+
+    /* 找到相同的调用栈，或者新建一条 */
+    for (i = 0; i < prof_nstacks; i++)
+    {
+        if (prof_stacks[i].depth == depth &&
+            !memcmp(prof_stacks[i].pc, pc + 1, depth * sizeof(void *)))
+            break;
+    }
+    st = &prof_stacks[i];
+    if (i == prof_nstacks)
+    {
+        if (prof_nstacks == PROF_MAXSTACKS)
+        {
+            prof_dropped++;
+            return;
+        }
+        prof_nstacks++;
+        memset(st, 0, sizeof(*st));
+        st->depth = depth;
+        memcpy(st->pc, pc + 1, depth * sizeof(void *));
+    }
+
+    st->alloc_objs++;
+    st->alloc_bytes += size;
+    st->inuse_objs++;
+    st->inuse_bytes += size;
+
+    for (h = PROF_HASH(ptr); prof_live_blocks[h].ptr != NULL; h = (h + 1) & (PROF_MAXLIVE - 1))
+        ;
+    prof_live_blocks[h].ptr = ptr;
+    prof_live_blocks[h].size = size;
+    prof_live_blocks[h].stack = i;
+    prof_live++;
+}
+
+static void prof_forget(void *ptr)
+{
+    unsigned int h, next, home;
+    prof_stack_t *st;
+
+    for (h = PROF_HASH(ptr); prof_live_blocks[h].ptr != ptr; h = (h + 1) & (PROF_MAXLIVE - 1))
+    {
+        if (prof_live_blocks[h].ptr == NULL)
+            return;
+    }
+
+    st = &prof_stacks[prof_live_blocks[h].stack];
+    st->inuse_objs--;
+    st->inuse_bytes -= prof_live_blocks[h].size;
+    prof_live_blocks[h].ptr = NULL;
+    prof_live--;
+
+    /* 线性探测删除：把后面探测序列经过h的项前移，不留墓碑 */
+    for (next = (h + 1) & (PROF_MAXLIVE - 1); prof_live_blocks[next].ptr != NULL;
+         next = (next + 1) & (PROF_MAXLIVE - 1))
+    {
+        home = PROF_HASH(prof_live_blocks[next].ptr);
+        /* home在(h, next]之间的项不需要移动 */
+        if (((next - home) & (PROF_MAXLIVE - 1)) < ((next - h) & (PROF_MAXLIVE - 1)))
+            continue;
+        prof_live_blocks[h] = prof_live_blocks[next];
+        prof_live_blocks[next].ptr = NULL;
+        h = next;
+    }
+}
@@ -5,6 +5,117 @@ extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
 
+/*
+ * Bytes the caller may use in an allocated block, at least the size
+ * it asked for. mm_realloc over-provisions blocks that keep growing,
+ * so callers can use the slack without calling it again.
+ */
+extern size_t mm_usable_size(void *ptr);
+
+/*
+ * The thread that called mm_init owns the heap and is the only one that
+ * may call mm_malloc and mm_realloc. Any thread may call mm_free: blocks
+ * freed by other threads are queued without locking and go back to the
+ * heap on the owner's next mm_malloc or mm_realloc. Calling mm_malloc
+ * or mm_realloc on any other thread prints an error and aborts.
+ */
+
+/*
+ * Free block search policies for mm_set_search_policy. The policy
+ * (and the best-fit probe limit) must be set before mm_init. Each
+ * free list is sorted by block size, so the first block that fits is
+ * the smallest of the blocks examined; best-fit relies on that order.
+ */
+#define MM_FIRST_FIT 0  /* walk each list until a block fits */
+#define MM_BEST_FIT  1  /* examine at most limit blocks per list */
+#define MM_GOOD_FIT  2  /* try the heads of two adjacent classes first */
+
+extern void mm_set_search_policy(int policy, int limit);
+extern double mm_avg_probes(void);
+
+/*
+ * Placement policies for mm_set_place_policy, deciding which end of a
+ * split free block is handed out. Set before mm_init, like the chunk
+ * sizes given to mm_set_chunk_sizes.
+ */
+#define MM_PLACE_SPLIT 0  /* blocks >= threshold from the tail, others head */
+#define MM_PLACE_HEAD  1  /* always allocate from the head */
+#define MM_PLACE_TAIL  2  /* always allocate from the tail */
+
+extern void mm_set_place_policy(int policy, size_t threshold);
+extern void mm_set_chunk_sizes(size_t initchunk, size_t chunk);
+
+/*
+ * Heap growth policies for mm_set_heap_growth. Either way, a free block
+ * at the end of the heap is merged with the new space first.
+ */
+#define MM_GROW_FIXED    0  /* grow by at least the chunk size */
+#define MM_GROW_ADAPTIVE 1  /* grow geometrically during allocation bursts */
+
+extern void mm_set_heap_growth(int policy);
+
+/*
+ * In BiBoP ("big bag of pages") mode, small requests are served from
+ * pages that each hold blocks of one size class. Set before mm_init.
+ */
+extern void mm_set_bibop(int enabled);
+
+/*
+ * Allocator statistics since the last mm_init. Size classes match the
+ * segregated free lists: class n holds blocks of [2^n, 2^(n+1)) bytes
+ * (block size including header and footer), the last class everything
+ * larger.
+ *
+ * The counters are plain per-heap variables, not thread-local or per-CPU
+ * copies. Only the owner thread updates them: blocks freed on other
+ * threads are counted when the owner drains them. So they are never
+ * contended. Call mm_stats on the owner thread for a consistent snapshot.
+ */
+#define MM_NCLASSES 16
+
+typedef struct {
+    unsigned long mallocs[MM_NCLASSES];     /* mm_malloc requests per class */
+    unsigned long frees[MM_NCLASSES];       /* mm_free calls per class */
+    unsigned long free_blocks[MM_NCLASSES]; /* current free list lengths */
+    unsigned long searches;      /* free list searches */
+    unsigned long probes;        /* free blocks examined by those searches */
+    unsigned long splits;        /* free blocks split by place */
+    unsigned long coalesces;     /* frees merged with a neighbour */
+    unsigned long extends;       /* heap extensions (mem_sbrk calls) */
+    unsigned long extend_bytes;  /* bytes added by those extensions */
+    unsigned long reallocs;      /* mm_realloc calls */
+    unsigned long realloc_copies;/* reallocs that had to move the block */
+    unsigned long bibop_mallocs; /* requests served from BiBoP pages */
+    unsigned long bibop_frees;   /* frees into BiBoP pages */
+    unsigned long bibop_pages;   /* BiBoP pages taken from the heap */
+    unsigned long remote_frees;  /* blocks freed by other threads */
+} mm_stats_t;
+
+extern void mm_stats(mm_stats_t *stats);
+
+/*
+ * mm_dump_layout walks the heap from mem_heap_lo() to mem_heap_hi() and
+ * writes it run-length encoded: after a "# heap <lo> <bytes>" line, one
+ * line per run of adjacent blocks of the same kind and size class,
+ *
+ *     <offset> <kind> <class> <blocks> <bytes>
+ *
+ * where offset is the run's first header relative to mem_heap_lo() and
+ * kind is a (allocated), f (free) or b (a run of BiBoP pages).
+ */
+extern int mm_dump_layout(FILE *fp);
+
+/*
+ * Sampling heap profiler. With a nonzero interval, mm_malloc records the
+ * call stack of about one allocation per interval bytes (the gaps are
+ * exponentially distributed), and mm_free forgets sampled blocks.
+ * mm_dump_profile writes the samples in pprof's heap_v2 text format;
+ * mm_profile_dropped counts samples lost because the tables were full.
+ */
+extern void mm_set_profile(size_t interval);
+extern int mm_dump_profile(FILE *fp);
+extern unsigned long mm_profile_dropped(void);
+
 
 /* 
  * Students work in teams of one or two.  Teams enter their team name, 
@@ -0,0 +1,82 @@
+/*
+ * mm_allocator.h - A std::allocator compatible adapter for the mm package.
+ *
+ * Use it with any standard container, e.g.
+ *
+ *     std::vector<int, mm_allocator<int> > v;
+ *     std::map<int, int, std::less<int>,
+ *              mm_allocator<std::pair<const int, int> > > m;
+ *
+ * The simulated heap in memlib.c is set up on first use by mm_cxx_init().
+ * The mm package is single-threaded and its blocks are only ALIGNMENT
+ * (8) byte aligned, so over-aligned types must not use this adapter.
+ */
+#ifndef __MM_ALLOCATOR_H_
+#define __MM_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+
+extern "C" {
+#include "mm.h"
+#include "memlib.h"
+}
+
+/*
+ * mm_cxx_init - initialize memlib and the mm package once per process
+ */
+inline void mm_cxx_init(void)
+{
+    static bool initialized = false;
+
+    /* Only a successful mm_init counts; a failed one is retried */
+    if (!initialized) {
+	mem_init();
+	if (mm_init() < 0) {
+	    mem_deinit();
+	    throw std::bad_alloc();
+	}
+	initialized = true;
+    }
+}
+
+template <class T>
+class mm_allocator {
+public:
+    typedef T value_type;
+
+    mm_allocator() noexcept {}
+    template <class U> mm_allocator(const mm_allocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+	void *p;
+
+	if (n > (std::size_t)-1 / sizeof(T))
+	    throw std::bad_alloc();
+	mm_cxx_init();
+	if ((p = mm_malloc(n * sizeof(T))) == NULL)
+	    throw std::bad_alloc();
+	return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, std::size_t) noexcept
+    {
+	mm_free(p);
+    }
+};
+
+/* All mm_allocators share the one heap, so any can free for any other */
+template <class T, class U>
+inline bool operator==(const mm_allocator<T> &, const mm_allocator<U> &) noexcept
+{
+    return true;
+}
+
+template <class T, class U>
+inline bool operator!=(const mm_allocator<T> &, const mm_allocator<U> &) noexcept
+{
+    return false;
+}
+
+#endif /* __MM_ALLOCATOR_H_ */
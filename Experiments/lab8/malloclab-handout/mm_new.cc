@@ -0,0 +1,215 @@
+/*
+ * mm_new.cc - Replace the global operator new and delete with the mm
+ *     package. Link mm_new.o (together with mm.o and memlib.o) into a
+ *     C++ program and every new/delete expression, including those made
+ *     by the standard containers, goes to mm_malloc and mm_free.
+ *
+ * The plain, array, nothrow, sized and aligned forms are all replaced.
+ * mm_malloc only guarantees ALIGNMENT (8) byte alignment, so the aligned
+ * forms over-allocate and keep the block mm_malloc returned in the word
+ * just before the aligned payload.
+ *
+ * Two restrictions of the mm package carry over to the whole program:
+ *
+ *   - Only the thread that made the first allocation owns the heap and
+ *     may allocate. Any thread may delete, but new on another thread
+ *     makes mm_malloc print an error and abort, so a program linked
+ *     with mm_new.o must allocate on one thread only.
+ *
+ *   - Everything comes out of the simulated heap, which holds at most
+ *     MAX_HEAP (20 MB, see config.h) for the life of the process. Once
+ *     it is exhausted the throwing forms throw std::bad_alloc (after
+ *     trying the new_handler) and the nothrow forms return NULL.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "mm_allocator.h"
+
+/*
+ * mm_new - allocate size bytes from the mm package, calling the
+ *     new_handler until it succeeds; returns NULL only if there is no
+ *     handler left to try.
+ */
+static void *mm_new(std::size_t size)
+{
+    void *p;
+
+    mm_cxx_init();
+    if (size == 0)
+	size = 1;
+    while ((p = mm_malloc(size)) == NULL) {
+	std::new_handler handler = std::get_new_handler();
+	if (handler == NULL)
+	    return NULL;
+	handler();
+    }
+    return p;
+}
+
+/*
+ * mm_delete - free a block from mm_new; delete of NULL is a no-op
+ */
+static void mm_delete(void *p)
+{
+    if (p != NULL)
+	mm_free(p);
+}
+
+/*
+ * mm_new_aligned - allocate size bytes aligned to align
+ */
+static void *mm_new_aligned(std::size_t size, std::size_t align)
+{
+    char *block;
+    std::uintptr_t payload;
+
+    if (align < sizeof(void *))
+	align = sizeof(void *);
+    if (size > (std::size_t)-1 - align - sizeof(void *))
+	return NULL;
+    if ((block = (char *)mm_new(size + align + sizeof(void *))) == NULL)
+	return NULL;
+
+    /* Leave room for the back pointer, then round up to align */
+    payload = ((std::uintptr_t)block + sizeof(void *) + align - 1) & ~(std::uintptr_t)(align - 1);
+    ((void **)payload)[-1] = block;
+    return (void *)payload;
+}
+
+/*
+ * mm_delete_aligned - free a block from mm_new_aligned
+ */
+static void mm_delete_aligned(void *p)
+{
+    if (p != NULL)
+	mm_free(((void **)p)[-1]);
+}
+
+/*
+ * Throwing forms
+ */
+void *operator new(std::size_t size)
+{
+    void *p = mm_new(size);
+
+    if (p == NULL)
+	throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    void *p = mm_new_aligned(size, (std::size_t)align);
+
+    if (p == NULL)
+	throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+/*
+ * Non-throwing forms. mm_cxx_init and the new_handler may still throw
+ * std::bad_alloc, which must not escape a noexcept function.
+ */
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+	return mm_new(size);
+    } catch (...) {
+	return NULL;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    try {
+	return mm_new_aligned(size, (std::size_t)align);
+    } catch (...) {
+	return NULL;
+    }
+}
+
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return operator new(size, align, std::nothrow);
+}
+
+/*
+ * Deallocation. mm_free finds the block size in the header, so the
+ * sized forms simply ignore the size.
+ */
+void operator delete(void *p) noexcept
+{
+    mm_delete(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    mm_delete(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    mm_delete(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    mm_delete(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    mm_delete(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    mm_delete(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    mm_delete_aligned(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    mm_delete_aligned(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    mm_delete_aligned(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    mm_delete_aligned(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    mm_delete_aligned(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    mm_delete_aligned(p);
+}
@@ -0,0 +1,55 @@
+/*
+ * tlbcount.c - Count data TLB misses with the Linux perf event interface
+ *
+ * The counter belongs to the process that called tlb_count_start and
+ * is not inherited across fork, so a forked child that wants to count
+ * its own misses has to call tlb_count_start again.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "tlbcount.h"
+
+static int tlb_fd = -1;  /* perf event file descriptor */
+
+/*
+ * tlb_count_start - open (or reopen) the dTLB load miss counter
+ */
+int tlb_count_start(void)
+{
+#if defined(__linux__) && defined(__NR_perf_event_open)
+    struct perf_event_attr attr;
+
+    if (tlb_fd >= 0)
+	close(tlb_fd);
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+	(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    tlb_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    return (tlb_fd >= 0);
+#else
+    return 0;
+#endif
+}
+
+/*
+ * tlb_count_get - read the number of misses counted so far
+ */
+double tlb_count_get(void)
+{
+    long long count;
+
+    if (tlb_fd < 0 || read(tlb_fd, &count, sizeof(count)) != sizeof(count))
+	return -1;
+    return (double)count;
+}
@@ -0,0 +1,11 @@
+/*
+ * Routines for counting data TLB misses with the hardware performance
+ * counters (Linux perf events only)
+ */
+
+/* Start counting dTLB load misses in this process. Returns 0 if the 
+   counter is not available */
+int tlb_count_start(void);
+
+/* Get # dTLB load misses since tlb_count_start, or -1 if unavailable */
+double tlb_count_get(void);